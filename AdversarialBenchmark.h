@@ -0,0 +1,184 @@
+#ifndef ADVERSARIAL_BENCHMARK_H
+#define ADVERSARIAL_BENCHMARK_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <iostream>
+#include <cstdio>
+#include <algorithm>
+#include "PHPLexer.h"
+#include "AllocationProfiler.h"
+#include "TokenFinder.h"
+
+// Pathological inputs for the lexer (and the token finder): each case is generated at growing sizes
+// to check that the time grows linearly and the memory used on top of the input doesn't grow with it.
+// Such inputs may come with untrusted code, so a case failing here is a bug of the lexer
+class AdversarialBenchmark
+{
+private:
+    struct Case {
+        std::string name;
+        std::function<std::string(size_t)> generate; // Input of about the size
+        std::function<void(std::string_view)> run; // Lexing or searching of the input
+    };
+
+    // Sink throwing the tokens away
+    class DiscardingSink: public TokenSink {
+    public:
+        size_t count = 0;
+
+        void onToken(const TokenView&) override {
+            count++;
+        }
+    };
+
+    static constexpr size_t MIN_SIZE = 256 * 1024;
+    static constexpr size_t MAX_SIZE = 4 * 1024 * 1024;
+    static constexpr size_t SIZE_STEP = 4;
+
+    // Time may grow by SIZE_STEP * MAX_GROWTH_SLACK when the size grows by SIZE_STEP,
+    // times below MIN_MEASURED_SECONDS are rounded up to it to not fail on noise of fast cases
+    static constexpr double MAX_GROWTH_SLACK = 2.0;
+    static constexpr double MIN_MEASURED_SECONDS = 0.001;
+    // Live heap bytes used on top of the input (extra memory) may grow by this when the size grows
+    static constexpr uint64_t MAX_EXTRA_GROWTH = 64 * 1024;
+
+    std::vector<Case> cases;
+    PHPLexer lexer;
+    DiscardingSink sink;
+    std::vector<TokenPredicate> predicates;
+    std::vector<TokenHit> hits;
+
+    // prefix, then unit repeated until the size is reached, then suffix
+    static std::string repeat(const std::string& prefix, const std::string& unit, const std::string& suffix, size_t size) {
+        std::string code = prefix;
+        code.reserve(size + unit.length() + suffix.length());
+        while (code.length() < size) {
+            code += unit;
+        }
+        code += suffix;
+        return code;
+    }
+
+    void lex(std::string_view code) {
+        try {
+            lexer.setSourceView(code);
+            lexer.getTokens(sink);
+        } catch (const LexerException& e) {
+            // Errors are expected for most cases, only time and memory matter
+        }
+    }
+
+    void addLexingCase(const std::string& name, const std::string& prefix, const std::string& unit, const std::string& suffix = "") {
+        cases.push_back(Case{
+            name,
+            [=](size_t size) { return repeat(prefix, unit, suffix, size); },
+            [this](std::string_view code) { lex(code); }
+        });
+    }
+
+    void addFindingCase(const std::string& name, const std::string& predicate, const std::string& prefix, const std::string& unit) {
+        cases.push_back(Case{
+            "find " + predicate + ": " + name,
+            [=](size_t size) { return repeat(prefix, unit, "", size); },
+            [this, predicate](std::string_view code) {
+                predicates.resize(1);
+                parseTokenPredicate(predicate, predicates[0]);
+                hits.clear();
+                TokenFinder finder(predicates);
+                finder.find(code, hits);
+            }
+        });
+    }
+
+    static double secondsOf(const std::function<void()>& action) {
+        auto start = std::chrono::steady_clock::now();
+        action();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+public:
+
+    AdversarialBenchmark() {
+        addLexingCase("long word", "", "a");
+        addLexingCase("long word starting with a boolean", "true", "e");
+        addLexingCase("long non-ASCII word", "", "\xD0\xB6");
+        addLexingCase("long identifier", "$", "a");
+        addLexingCase("long integer", "", "1");
+        addLexingCase("long float", "0.", "1");
+        addLexingCase("operator soup", "", "<=> === !== && || << >> -> :: => ?-> += ");
+        addLexingCase("packed operator soup", "", "+-*/%=&|^~<>!?:.@");
+        addLexingCase("repeated /*", "", "/*");
+        addLexingCase("repeated /**/", "", "/**/");
+        addLexingCase("comment of stars", "/*", "*", "/");
+        addLexingCase("unterminated comment at the end", "", "$a ", "/*");
+        addLexingCase("unterminated inline comment at the end", "#", "a");
+        addLexingCase("unterminated string", "\"", "a");
+        addLexingCase("unterminated strings per line", "", "'a\n");
+        addLexingCase("brackets", "", "(");
+        addLexingCase("whitespace", "", " \t\r\n");
+        addLexingCase("ignored characters", "", "\\");
+
+        addFindingCase("occurrences inside identifiers", "keyword:echo", "", "$echo");
+        addFindingCase("identifiers without whitespace", "identifier:$a", "", "$a");
+        addFindingCase("occurrences after a broken word", "identifier:$a", "x", "$a");
+        addFindingCase("occurrences inside a word", "keyword:a*", "", "a");
+    }
+
+    // Prints time per MB and extra memory of every case at every size, returns false if any case isn't linear or bounded
+    bool run(std::ostream& out) {
+
+        bool isPassed = true;
+        char line[256];
+
+        for (const auto& benchmarkCase : cases) {
+
+            out << benchmarkCase.name << std::endl;
+            double previousSeconds = 0;
+            uint64_t previousExtraBytes = 0;
+            bool isCasePassed = true;
+
+            for (size_t size = MIN_SIZE; size <= MAX_SIZE && isCasePassed; size *= SIZE_STEP) {
+
+                std::string code = benchmarkCase.generate(size);
+                benchmarkCase.run(code); // Warming up: buffers of the lexer grow to their size
+
+                resetAllocationPeak();
+                AllocationStats before = getAllocationStats();
+                double seconds = secondsOf([&]() { benchmarkCase.run(code); });
+                AllocationStats after = getAllocationStats();
+                for (int i = 0; i < 2; i++) {
+                    seconds = std::min(seconds, secondsOf([&]() { benchmarkCase.run(code); }));
+                }
+                seconds = std::max(seconds, MIN_MEASURED_SECONDS);
+
+                uint64_t extraBytes = after.peakLiveBytes - before.liveBytes;
+                bool isLinear = previousSeconds == 0 || seconds <= previousSeconds * SIZE_STEP * MAX_GROWTH_SLACK;
+                bool isBounded = !ALLOCATION_PROFILING_ENABLED || previousSeconds == 0 || extraBytes <= previousExtraBytes + MAX_EXTRA_GROWTH;
+                isCasePassed = isLinear && isBounded;
+                previousSeconds = seconds;
+                previousExtraBytes = extraBytes;
+
+                snprintf(line, sizeof(line), "\t%8zu KB %10.3f ms %10.1f MB/s", code.length() / 1024, seconds * 1000,
+                    code.length() / (1024.0 * 1024.0) / seconds);
+                out << line;
+                if (ALLOCATION_PROFILING_ENABLED) {
+                    out << "\textra memory " << extraBytes << " B";
+                }
+                out << (isLinear ? "" : "\tNOT LINEAR") << (isBounded ? "" : "\tNOT BOUNDED") << std::endl;
+            }
+
+            isPassed = isPassed && isCasePassed;
+        }
+
+        if (!ALLOCATION_PROFILING_ENABLED) {
+            out << "Memory isn't checked, recompile with -DLEXER_PROFILE_ALLOCATIONS" << std::endl;
+        }
+        return isPassed;
+    }
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "AllocationProfiler.h"
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <algorithm>
+
+#ifdef LEXER_PROFILE_ALLOCATIONS
+
+namespace allocation_profiler {
+
+    const int MAX_SCOPES = 32;
+
+    std::atomic<uint64_t> allocations(0);
+    std::atomic<uint64_t> bytes(0);
+    std::atomic<uint64_t> liveBytes(0);
+    std::atomic<uint64_t> peakLiveBytes(0);
+
+    const char* scopeNames[MAX_SCOPES];
+    std::atomic<uint64_t> scopeAllocations[MAX_SCOPES];
+    std::atomic<uint64_t> scopeBytes[MAX_SCOPES];
+    std::atomic<int> scopeCount(0);
+
+    thread_local int currentScope = -1;
+
+    // Size is kept before the block to know it on delete, 16 bytes keep the block aligned
+    const size_t HEADER_SIZE = 16;
+
+    void* allocate(size_t size) {
+
+        void* block = std::malloc(size + HEADER_SIZE);
+        if (block == nullptr) {
+            return nullptr;
+        }
+        *static_cast<size_t*>(block) = size;
+
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+        uint64_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        uint64_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+        while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+
+        if (currentScope >= 0) {
+            scopeAllocations[currentScope].fetch_add(1, std::memory_order_relaxed);
+            scopeBytes[currentScope].fetch_add(size, std::memory_order_relaxed);
+        }
+
+        return static_cast<char*>(block) + HEADER_SIZE;
+    }
+
+    void deallocate(void* pointer) {
+        if (pointer == nullptr) {
+            return;
+        }
+        void* block = static_cast<char*>(pointer) - HEADER_SIZE;
+        liveBytes.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+
+    int registerScope(const char* name) {
+        int id = scopeCount.fetch_add(1);
+        if (id >= MAX_SCOPES) {
+            return -1; // Not profiled separately, still counted in totals
+        }
+        scopeNames[id] = name;
+        return id;
+    }
+}
+
+void* operator new(size_t size) {
+    void* pointer = allocation_profiler::allocate(size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocation_profiler::allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocation_profiler::allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    allocation_profiler::deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    allocation_profiler::deallocate(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    allocation_profiler::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    allocation_profiler::deallocate(pointer);
+}
+
+AllocationStats getAllocationStats() {
+    AllocationStats stats;
+    stats.allocations = allocation_profiler::allocations.load();
+    stats.bytes = allocation_profiler::bytes.load();
+    stats.liveBytes = allocation_profiler::liveBytes.load();
+    stats.peakLiveBytes = allocation_profiler::peakLiveBytes.load();
+    return stats;
+}
+
+void resetAllocationPeak() {
+    allocation_profiler::peakLiveBytes.store(allocation_profiler::liveBytes.load());
+}
+
+int getAllocationScopeStats(AllocationScopeStats* stats, int maxCount) {
+    int count = std::min(allocation_profiler::scopeCount.load(), allocation_profiler::MAX_SCOPES);
+    count = std::min(count, maxCount);
+    for (int i = 0; i < count; i++) {
+        stats[i].name = allocation_profiler::scopeNames[i];
+        stats[i].allocations = allocation_profiler::scopeAllocations[i].load();
+        stats[i].bytes = allocation_profiler::scopeBytes[i].load();
+    }
+    return count;
+}
+
+#else
+
+AllocationStats getAllocationStats() {
+    return AllocationStats();
+}
+
+void resetAllocationPeak() {
+}
+
+int getAllocationScopeStats(AllocationScopeStats* /* stats */, int /* maxCount */) {
+    return 0;
+}
+
+#endif
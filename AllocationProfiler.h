@@ -0,0 +1,71 @@
+#ifndef ALLOCATION_PROFILER_H
+#define ALLOCATION_PROFILER_H
+
+#include <cstdint>
+
+// Heap allocation profiler of the lexer.
+// Only works in the instrumentation build (compiled with -DLEXER_PROFILE_ALLOCATIONS):
+// global operator new/delete are replaced by counting ones, and the lexer marks its methods
+// with LEXER_ALLOCATION_SCOPE(name), so allocations are also counted per method.
+// In the regular build nothing is replaced and the scopes compile to nothing.
+
+// Allocation counters, all of them are zero in the regular build
+struct AllocationStats {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    uint64_t liveBytes = 0;
+    uint64_t peakLiveBytes = 0;
+};
+
+// Counters of allocations made inside a LEXER_ALLOCATION_SCOPE
+struct AllocationScopeStats {
+    const char* name;
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+#ifdef LEXER_PROFILE_ALLOCATIONS
+
+const bool ALLOCATION_PROFILING_ENABLED = true;
+
+namespace allocation_profiler {
+    extern thread_local int currentScope;
+
+    // Scopes are registered once per place in the code, no allocation happens while registering
+    int registerScope(const char* name);
+}
+
+// Counts allocations of the enclosing block into the scope, scopes may be nested
+class AllocationScope {
+private:
+    int previousScope;
+public:
+    explicit AllocationScope(int scope) : previousScope(allocation_profiler::currentScope) {
+        allocation_profiler::currentScope = scope;
+    }
+    ~AllocationScope() {
+        allocation_profiler::currentScope = previousScope;
+    }
+};
+
+#define LEXER_ALLOCATION_SCOPE(name) \
+    static const int allocationScopeId = allocation_profiler::registerScope(name); \
+    AllocationScope allocationScope(allocationScopeId)
+
+#else
+
+const bool ALLOCATION_PROFILING_ENABLED = false;
+
+#define LEXER_ALLOCATION_SCOPE(name)
+
+#endif
+
+AllocationStats getAllocationStats();
+
+// Makes the peak equal to the current live bytes, to measure the peak of the following code
+void resetAllocationPeak();
+
+// Fills the array with the stats of the scopes, returns the number of scopes
+int getAllocationScopeStats(AllocationScopeStats* stats, int maxCount);
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef CODE_MINIFIER_H
+#define CODE_MINIFIER_H
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include "PHPLexer.h"
+
+// Rewrites the code without comments and with the least whitespace keeping tokens apart.
+// Works as a TokenSink: token spans are copied into one buffer sized by the code (the output is never longer),
+// so nothing is allocated per token. Tokens written next to each other in the code stay so,
+// a single space is put only where trivia is removed between tokens that could merge otherwise.
+// Bytes the lexer skips without a token (e.g. a backslash) aren't trivia, they are copied like tokens
+class CodeMinifier: public TokenSink
+{
+private:
+    std::string output;
+    size_t outputLength = 0;
+    const char* previousEnd = nullptr; // End of the previous written token in the code
+    const char* scannedEnd = nullptr; // End of the previous token in the code, written or not
+
+    // Classes of characters that may continue each other into one token
+    enum CharClass {
+        WORD, // Names, identifiers, numbers
+        SYMBOL, // Operators and punctuation like :: => -> ?->
+        OTHER // Brackets, quotes and the rest never merge with their neighbours
+    };
+
+    static CharClass charClass(char ch) {
+        if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')
+            || ch == '_' || ch == '$' || static_cast<unsigned char>(ch) >= 0x80) {
+            return WORD;
+        }
+        // Operator symbols of PHPLexer::isOperatorSymbol and punctuation not being brackets
+        constexpr std::string_view symbols = "+-*/%=&|^~<>!?:.@;,";
+        if (symbols.find(ch) != std::string_view::npos) {
+            return SYMBOL;
+        }
+        return OTHER;
+    }
+
+    static bool isSeparatorNeeded(char last, char first) {
+        CharClass lastClass = charClass(last);
+        CharClass firstClass = charClass(first);
+        // '.' continues both numbers (1.5) and symbols (...)
+        if (last == '.' || first == '.') {
+            return firstClass != OTHER && lastClass != OTHER;
+        }
+        return lastClass == firstClass && lastClass != OTHER;
+    }
+
+    static bool isWhitespace(char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+    }
+
+    void write(const char* start, size_t length) {
+        if (previousEnd != nullptr && previousEnd != start && isSeparatorNeeded(*(previousEnd - 1), *start)) {
+            output[outputLength++] = ' ';
+        }
+        memcpy(&output[outputLength], start, length);
+        outputLength += length;
+        previousEnd = start + length;
+    }
+
+    // Writes the bytes between the tokens which aren't whitespace, runs of them are written as one span
+    void writeGap(const char* start, const char* end) {
+        const char* p = start;
+        while (p < end) {
+            while (p < end && isWhitespace(*p)) {
+                p++;
+            }
+            const char* spanStart = p;
+            while (p < end && !isWhitespace(*p)) {
+                p++;
+            }
+            if (p > spanStart) {
+                write(spanStart, p - spanStart);
+            }
+        }
+    }
+
+public:
+
+    // Prepares the buffer for the code, must be called before lexing it
+    void reset(std::string_view sourceCode) {
+        if (output.size() < sourceCode.length()) {
+            output.resize(sourceCode.length());
+        }
+        outputLength = 0;
+        previousEnd = nullptr;
+        scannedEnd = sourceCode.data();
+
+        // Byte order mark is skipped by the lexer, but it's kept in the output
+        if (sourceCode.substr(0, 3) == "\xEF\xBB\xBF") {
+            memcpy(&output[0], sourceCode.data(), 3);
+            outputLength = 3;
+            scannedEnd += 3;
+        }
+    }
+
+    void onToken(const TokenView& token) override {
+
+        const char* start = token.value.data();
+        writeGap(scannedEnd, start); // END_OF_FILE has no text, but bytes before it may be left
+        scannedEnd = start + token.value.length();
+
+        if (token.type == TokenType::COMMENT || token.value.empty()) {
+            return;
+        }
+        write(start, token.value.length());
+    }
+
+    // Minified code, valid until the next reset()
+    std::string_view getOutput() const {
+        return std::string_view(output.data(), outputLength);
+    }
+};
+
+#endif
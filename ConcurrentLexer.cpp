@@ -0,0 +1,152 @@
+#include "ConcurrentLexer.h"
+
+ConcurrentLexer::ConcurrentLexer(size_t batchSize, size_t ringSize)
+: batchSize(batchSize > 0 ? batchSize : 1), batches(ringSize > 2 ? ringSize : 2) {
+
+    for (auto& batch : batches) {
+        batch.reserve(this->batchSize);
+    }
+}
+
+ConcurrentLexer::~ConcurrentLexer() {
+    stop();
+}
+
+void ConcurrentLexer::RingSink::onToken(const TokenView& token) {
+
+    std::vector<TokenView>& batch = owner.batches[owner.published.load(std::memory_order_relaxed) % owner.batches.size()];
+    batch.push_back(token);
+
+    if (batch.size() == owner.batchSize) {
+        owner.publishBatch();
+    }
+}
+
+template <typename Condition>
+void ConcurrentLexer::waitFor(Condition isReady) {
+
+    for (int i = 0; i < SPIN_LIMIT; i++) {
+        if (isReady()) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(waitMutex);
+    sleepers.fetch_add(1);
+    // Pairs with the fence of notifyProgress(): either the condition is seen true here,
+    // or the other side sees the sleeper and notifies it under the mutex
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    progressed.wait(lock, isReady);
+    sleepers.fetch_sub(1);
+}
+
+void ConcurrentLexer::notifyProgress() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        progressed.notify_all();
+    }
+}
+
+void ConcurrentLexer::publishBatch() {
+
+    size_t batchNumber = published.load(std::memory_order_relaxed);
+
+    // The next batch to fill must be released by the consumer
+    auto isNextBatchFree = [&]() {
+        return batchNumber + 1 - consumed.load(std::memory_order_acquire) < batches.size();
+    };
+    waitFor([&]() { return isNextBatchFree() || cancelled.load(std::memory_order_relaxed); });
+    if (!isNextBatchFree()) {
+        throw CancelledException();
+    }
+
+    published.store(batchNumber + 1, std::memory_order_release);
+    notifyProgress();
+    batches[(batchNumber + 1) % batches.size()].clear();
+}
+
+void ConcurrentLexer::produce(std::string_view code) {
+
+    RingSink sink(*this);
+    try {
+        lexer.setSourceView(code);
+        lexer.getTokens(sink);
+    } catch (const CancelledException&) {
+        return;
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    // Publishing the rest of tokens, waiting for a free batch is not needed for the last one
+    if (!batches[published.load(std::memory_order_relaxed) % batches.size()].empty()) {
+        published.store(published.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    finished.store(true, std::memory_order_release);
+    notifyProgress();
+}
+
+void ConcurrentLexer::stop() {
+    if (producer.joinable()) {
+        cancelled.store(true);
+        notifyProgress();
+        producer.join();
+    }
+}
+
+void ConcurrentLexer::start(std::string_view code) {
+
+    stop();
+
+    published.store(0);
+    consumed.store(0);
+    finished.store(false);
+    cancelled.store(false);
+    error = nullptr;
+    isHoldingBatch = false;
+    batches[0].clear();
+
+    producer = std::thread(&ConcurrentLexer::produce, this, code);
+}
+
+bool ConcurrentLexer::nextBatch(const TokenView*& tokens, size_t& count) {
+
+    size_t batchNumber = consumed.load(std::memory_order_relaxed);
+
+    // Giving the previous batch back to the producer
+    if (isHoldingBatch) {
+        batchNumber++;
+        consumed.store(batchNumber, std::memory_order_release);
+        notifyProgress();
+        isHoldingBatch = false;
+    }
+
+    while (true) {
+        if (batchNumber < published.load(std::memory_order_acquire)) {
+            const std::vector<TokenView>& batch = batches[batchNumber % batches.size()];
+            tokens = batch.data();
+            count = batch.size();
+            isHoldingBatch = true;
+            return true;
+        }
+        if (finished.load(std::memory_order_acquire)) {
+            // Re-checking: the last batch may be published right before finishing
+            if (batchNumber < published.load(std::memory_order_acquire)) {
+                continue;
+            }
+            if (producer.joinable()) {
+                producer.join();
+            }
+            if (error) {
+                std::exception_ptr lexerError = error;
+                error = nullptr;
+                std::rethrow_exception(lexerError);
+            }
+            return false;
+        }
+        waitFor([&]() {
+            return batchNumber < published.load(std::memory_order_acquire) || finished.load(std::memory_order_acquire);
+        });
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef CONCURRENT_LEXER_H
+#define CONCURRENT_LEXER_H
+
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include "PHPLexer.h"
+
+// Runs PHPLexer on its own thread, so lexing overlaps with a heavy consumer (e.g. a parser).
+// Tokens are passed in batches through a lock-free single-producer/single-consumer ring:
+// the lexer waits when all the batches of the ring are full (backpressure), so the memory
+// for tokens is bounded by the ring size whatever the code size is.
+// A side waiting for the other spins for a while, then sleeps until the other side makes progress,
+// so an idle consumer (or a lexer blocked by a slow consumer) doesn't keep a core busy.
+// Usage:
+//     ConcurrentLexer lexer;
+//     lexer.start(code);
+//     const TokenView* tokens;
+//     size_t count;
+//     while (lexer.nextBatch(tokens, count)) { ...use tokens[0..count)... }
+// The last batch ends with END_OF_FILE. If lexing fails, nextBatch() rethrows the LexerException
+// after the tokens extracted before the error. Only one thread may call nextBatch()
+class ConcurrentLexer
+{
+private:
+    // Thrown inside the lexer thread to stop it when the consumer gives up
+    class CancelledException: public std::exception {};
+
+    // Sink of the lexer thread filling the batches of the ring
+    class RingSink: public TokenSink {
+    private:
+        ConcurrentLexer& owner;
+    public:
+        explicit RingSink(ConcurrentLexer& o) : owner(o) {}
+        void onToken(const TokenView& token) override;
+    };
+
+    size_t batchSize;
+    std::vector<std::vector<TokenView>> batches; // The ring, batch i is used as i % batches.size()
+
+    // Batches [consumed, published) are ready for the consumer, the rest belong to the producer.
+    // Both only grow, each is written by one side only
+    std::atomic<size_t> published{0};
+    std::atomic<size_t> consumed{0};
+
+    std::atomic<bool> finished{true}; // Set by the producer after publishing the last batch, nothing to wait before start()
+    std::atomic<bool> cancelled{false}; // Set by the consumer to stop the producer
+    std::exception_ptr error; // Lexer's exception, written before finished is set
+
+    bool isHoldingBatch = false; // If the consumer holds the batch returned by the last nextBatch()
+
+    // Checks of the condition before sleeping, the other side is usually quick
+    static constexpr int SPIN_LIMIT = 64;
+    std::mutex waitMutex;
+    std::condition_variable progressed;
+    std::atomic<int> sleepers{0}; // Sides sleeping on progressed, notifying is skipped while there are none
+
+    PHPLexer lexer;
+    std::thread producer;
+
+    void produce(std::string_view code);
+
+    // Returns when isReady() is true: spins SPIN_LIMIT times, then sleeps until notifyProgress()
+    template <typename Condition>
+    void waitFor(Condition isReady);
+
+    // Wakes up the other side if it sleeps, called after every change of the ring state
+    void notifyProgress();
+
+    // Makes the current batch available to the consumer, waits while the ring is full
+    void publishBatch();
+
+    // Stops the producer and waits for it
+    void stop();
+
+public:
+    // batchSize - tokens per batch, ringSize - number of batches in the ring
+    // (at least 2: one is filled by the lexer while another is used by the consumer, smaller values are raised to 2)
+    explicit ConcurrentLexer(size_t batchSize = 1024, size_t ringSize = 8);
+    ~ConcurrentLexer();
+
+    ConcurrentLexer(const ConcurrentLexer&) = delete;
+    ConcurrentLexer& operator=(const ConcurrentLexer&) = delete;
+
+    // Starts lexing the code on the lexer thread, the code must be alive until the tokens are used.
+    // Lexing of the previous code is stopped if it's still running
+    void start(std::string_view code);
+
+    // Gives the next batch of tokens, it's valid until the next call.
+    // Returns false when all the tokens are consumed, may throw LexerException of the lexer
+    bool nextBatch(const TokenView*& tokens, size_t& count);
+};
+
+#endif
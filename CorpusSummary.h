@@ -0,0 +1,209 @@
+#ifndef CORPUS_SUMMARY_H
+#define CORPUS_SUMMARY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include "PHPLexer.h"
+#include "JsonUtils.h"
+
+// Approximate counter of the most frequent values (Misra-Gries summary).
+// Keeps at most 2 * capacity values: when the table is full the capacity-th biggest count
+// is subtracted from all the values and the ones dropping to zero are removed.
+// Counts are lower bounds, each is at most (total / capacity) below the real one.
+// Summaries of different threads are merged the same way
+class HeavyHitters
+{
+private:
+    size_t capacity;
+    std::unordered_map<std::string, uint64_t> counts;
+    std::string key; // Reused to look values up without allocating
+
+    // Shrinks the table to at most capacity values
+    void reduce() {
+
+        if (counts.size() <= capacity) {
+            return;
+        }
+
+        std::vector<uint64_t> values;
+        values.reserve(counts.size());
+        for (const auto& entry : counts) {
+            values.push_back(entry.second);
+        }
+        std::nth_element(values.begin(), values.begin() + capacity, values.end(), std::greater<uint64_t>());
+        uint64_t decrement = values[capacity];
+
+        for (auto it = counts.begin(); it != counts.end();) {
+            if (it->second <= decrement) {
+                it = counts.erase(it);
+            } else {
+                it->second -= decrement;
+                ++it;
+            }
+        }
+    }
+
+public:
+    explicit HeavyHitters(size_t c = 1024) : capacity(c) {}
+
+    void add(std::string_view value, uint64_t count = 1) {
+
+        key.assign(value.data(), value.length());
+        auto it = counts.find(key);
+        if (it != counts.end()) {
+            it->second += count;
+            return;
+        }
+
+        counts.emplace(key, count);
+        if (counts.size() >= 2 * capacity) {
+            reduce();
+        }
+    }
+
+    void merge(const HeavyHitters& other) {
+        for (const auto& entry : other.counts) {
+            add(entry.first, entry.second);
+        }
+        reduce();
+    }
+
+    // Returns up to n most frequent values, the most frequent first
+    std::vector<std::pair<std::string, uint64_t>> top(size_t n) const {
+
+        std::vector<std::pair<std::string, uint64_t>> result(counts.begin(), counts.end());
+        std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        if (result.size() > n) {
+            result.resize(n);
+        }
+        return result;
+    }
+};
+
+// Aggregated statistics of the lexed code, nothing but counters is kept.
+// Works as a TokenSink, each thread has its own summary, summaries are merged at the end
+class CorpusSummary: public TokenSink
+{
+private:
+    static const size_t TYPES_COUNT = static_cast<size_t>(TokenType::END_OF_FILE) + 1;
+
+    uint64_t files = 0;
+    uint64_t filesWithErrors = 0;
+    uint64_t unreadableFiles = 0;
+    uint64_t bytes = 0;
+    uint64_t tokenCounts[TYPES_COUNT] = {};
+    uint64_t tokenBytes[TYPES_COUNT] = {};
+
+    HeavyHitters identifiers;
+    HeavyHitters keywords;
+
+    static void appendTop(std::string& out, const HeavyHitters& hitters, size_t n) {
+        out += '[';
+        bool first = true;
+        for (const auto& entry : hitters.top(n)) {
+            if (!first) {
+                out += ',';
+            }
+            first = false;
+            out += "{\"value\":";
+            appendJsonString(out, entry.first);
+            out += ",\"count\":" + std::to_string(entry.second) + "}";
+        }
+        out += ']';
+    }
+
+public:
+
+    void onToken(const TokenView& token) override {
+
+        size_t type = static_cast<size_t>(token.type);
+        tokenCounts[type]++;
+        tokenBytes[type] += token.value.length();
+
+        if (token.type == TokenType::IDENTIFIER) {
+            identifiers.add(token.value);
+        } else if (token.type == TokenType::KEYWORD) {
+            keywords.add(token.value);
+        }
+    }
+
+    // Called once per lexed file, before its tokens
+    void addFile(size_t fileBytes) {
+        files++;
+        bytes += fileBytes;
+    }
+
+    void addLexerError() {
+        filesWithErrors++;
+    }
+
+    void addUnreadableFile() {
+        unreadableFiles++;
+    }
+
+    void merge(const CorpusSummary& other) {
+        files += other.files;
+        filesWithErrors += other.filesWithErrors;
+        unreadableFiles += other.unreadableFiles;
+        bytes += other.bytes;
+        for (size_t i = 0; i < TYPES_COUNT; i++) {
+            tokenCounts[i] += other.tokenCounts[i];
+            tokenBytes[i] += other.tokenBytes[i];
+        }
+        identifiers.merge(other.identifiers);
+        keywords.merge(other.keywords);
+    }
+
+    // Summary as a JSON object, topN most frequent identifiers and keywords are included
+    std::string toJson(size_t topN = 20) const {
+
+        uint64_t commentBytes = tokenBytes[static_cast<size_t>(TokenType::COMMENT)];
+        uint64_t codeBytes = 0;
+        for (size_t i = 0; i < TYPES_COUNT; i++) {
+            if (i != static_cast<size_t>(TokenType::COMMENT)) {
+                codeBytes += tokenBytes[i];
+            }
+        }
+
+        std::string out = "{";
+        out += "\"files\":" + std::to_string(files);
+        out += ",\"filesWithErrors\":" + std::to_string(filesWithErrors);
+        out += ",\"unreadableFiles\":" + std::to_string(unreadableFiles);
+        out += ",\"bytes\":" + std::to_string(bytes);
+
+        out += ",\"tokens\":{";
+        for (size_t i = 0; i < TYPES_COUNT; i++) {
+            if (i > 0) {
+                out += ',';
+            }
+            out += '"';
+            out += tokenTypeName(static_cast<TokenType>(i));
+            out += "\":{\"count\":" + std::to_string(tokenCounts[i]) + ",\"bytes\":" + std::to_string(tokenBytes[i]) + "}";
+        }
+        out += '}';
+
+        char ratio[32];
+        snprintf(ratio, sizeof(ratio), "%.4f", codeBytes > 0 ? static_cast<double>(commentBytes) / codeBytes : 0.0);
+        out += ",\"commentBytes\":" + std::to_string(commentBytes);
+        out += ",\"codeBytes\":" + std::to_string(codeBytes);
+        out += ",\"commentToCodeRatio\":";
+        out += ratio;
+
+        out += ",\"topIdentifiers\":";
+        appendTop(out, identifiers, topN);
+        out += ",\"topKeywords\":";
+        appendTop(out, keywords, topN);
+
+        out += '}';
+        return out;
+    }
+};
+
+#endif
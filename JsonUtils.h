@@ -0,0 +1,45 @@
+#ifndef JSON_UTILS_H
+#define JSON_UTILS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdio>
+#include "Utf8Validator.h"
+
+// Appends the value as a quoted JSON string.
+// JSON must be valid UTF-8, so bytes of invalid sequences (e.g. from Latin-1 files) are replaced by U+FFFD
+inline void appendJsonString(std::string& out, std::string_view value) {
+    thread_local std::vector<size_t> invalidOffsets;
+    invalidOffsets.clear();
+    validateUtf8(value, invalidOffsets);
+    size_t nextInvalid = 0;
+
+    out += '"';
+    for (size_t i = 0; i < value.length(); i++) {
+        char ch = value[i];
+        if (nextInvalid < invalidOffsets.size() && invalidOffsets[nextInvalid] == i) {
+            out += "\\ufffd";
+            nextInvalid++;
+            continue;
+        }
+        switch (ch) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+                    out += escaped;
+                } else {
+                    out += ch;
+                }
+        }
+    }
+    out += '"';
+}
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef LEXER_PIPELINE_H
+#define LEXER_PIPELINE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <filesystem>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Recursively collects all .php files of the directory, sorted by path
+inline std::vector<std::string> collectPhpFiles(const std::string& directory) {
+
+    std::vector<std::string> files;
+    std::error_code error;
+
+    auto options = std::filesystem::directory_options::skip_permission_denied;
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, options, error);
+         it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+
+        if (error) {
+            break;
+        }
+        if (it->is_regular_file(error) && it->path().extension() == ".php") {
+            files.push_back(it->path().string());
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Queue with limited capacity shared by threads:
+// push() waits while the queue is full, pop() waits while it's empty.
+// After close() pop() returns false as soon as the queue is empty
+template <typename T>
+class BoundedQueue
+{
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+
+public:
+    explicit BoundedQueue(size_t c) : capacity(c) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+};
+
+// Reads files and lexes them at the same time:
+//     reader threads read files ahead into pooled buffers,
+//     lexer threads take the filled buffers and pass them to the handler.
+// The number of buffers bounds the memory, readers wait for a free buffer when lexers are behind.
+// Handlers are called from lexer threads, each lexer thread has its own index,
+// so handlers can keep per-thread state (e.g. a PHPLexer) without locking
+class LexerPipeline
+{
+public:
+    // Called for every file read: (lexer thread index, file index, file content)
+    using FileHandler = std::function<void(size_t, size_t, std::string_view)>;
+    // Called for every file that can't be read: (lexer thread index, file index)
+    using ReadErrorHandler = std::function<void(size_t, size_t)>;
+
+private:
+    size_t lexerThreads;
+    size_t readerThreads;
+    size_t bufferCount;
+
+    struct ReadJob {
+        size_t fileIndex;
+        size_t bufferIndex;
+        bool isRead;
+    };
+
+    // Reads the whole file into the buffer, the buffer keeps its capacity between files
+    static bool readFileInto(const std::string& filename, std::string& buffer) {
+
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) < 0) {
+            close(fd);
+            return false;
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        // Size may change while reading, so reading until the end anyway
+        buffer.resize(static_cast<size_t>(fileStat.st_size) + 1);
+        size_t done = 0;
+        while (true) {
+            if (done == buffer.size()) {
+                buffer.resize(buffer.size() * 2);
+            }
+            ssize_t n = pread(fd, &buffer[done], buffer.size() - done, done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                close(fd);
+                return false;
+            }
+            if (n == 0) {
+                break;
+            }
+            done += n;
+        }
+        buffer.resize(done);
+
+        close(fd);
+        return true;
+    }
+
+public:
+
+    // lexers - number of lexer threads (0 means the number of cores),
+    // readers - number of reader threads, buffers - number of pooled buffers (0 means twice the lexers)
+    explicit LexerPipeline(size_t lexers = 0, size_t readers = 4, size_t buffers = 0)
+    : lexerThreads(lexers), readerThreads(readers), bufferCount(buffers) {
+
+        if (lexerThreads == 0) {
+            lexerThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (readerThreads == 0) {
+            readerThreads = 1;
+        }
+        if (bufferCount == 0) {
+            bufferCount = 2 * lexerThreads;
+        }
+    }
+
+    size_t getLexerThreads() const {
+        return lexerThreads;
+    }
+
+    void run(const std::vector<std::string>& files, const FileHandler& handler, const ReadErrorHandler& errorHandler) {
+
+        std::vector<std::string> buffers(bufferCount);
+        BoundedQueue<size_t> freeBuffers(bufferCount);
+        for (size_t i = 0; i < bufferCount; i++) {
+            freeBuffers.push(i);
+        }
+
+        BoundedQueue<ReadJob> readJobs(bufferCount);
+        std::atomic<size_t> nextFile(0);
+        std::atomic<size_t> activeReaders(readerThreads);
+
+        auto readerLoop = [&]() {
+            size_t fileIndex;
+            while ((fileIndex = nextFile.fetch_add(1)) < files.size()) {
+                size_t bufferIndex = 0;
+                freeBuffers.pop(bufferIndex);
+                bool isRead = readFileInto(files[fileIndex], buffers[bufferIndex]);
+                readJobs.push(ReadJob{fileIndex, bufferIndex, isRead});
+            }
+            // The last reader tells lexers there is nothing more to wait for
+            if (activeReaders.fetch_sub(1) == 1) {
+                readJobs.close();
+            }
+        };
+
+        auto lexerLoop = [&](size_t lexerIndex) {
+            ReadJob job;
+            while (readJobs.pop(job)) {
+                if (job.isRead) {
+                    handler(lexerIndex, job.fileIndex, buffers[job.bufferIndex]);
+                } else {
+                    errorHandler(lexerIndex, job.fileIndex);
+                }
+                freeBuffers.push(job.bufferIndex);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < readerThreads; i++) {
+            threads.emplace_back(readerLoop);
+        }
+        for (size_t i = 0; i < lexerThreads; i++) {
+            threads.emplace_back(lexerLoop, i);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+};
+
+#endif
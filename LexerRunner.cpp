@@ -3,41 +3,61 @@
 #include <sstream>
 #include <list>
 #include <string>
-#include "PHPLexer.cpp"
+#include <map>
+#include <cmath>
+#include "AllocationProfiler.h"
+#include "PHPLexer.h"
+#include "ConcurrentLexer.h"
+#include "JsonUtils.h"
+#include "LexerServer.h"
+#include "TokenFingerprint.h"
+#include "LexerPipeline.h"
+#include "CorpusSummary.h"
+#include "TokenFinder.h"
+#include "CodeMinifier.h"
+#include "AdversarialBenchmark.h"
+#include "TreeWatcher.h"
+#include "TokenIndex.h"
+
+// Works for both Token and TokenView
+template <typename T>
+void coutToken(const T& token) {
+
+    if (token.type == TokenType::COMMENT) {
+        std::cout << "Comment: " << token.value << std::endl;
+    }
+    else if (token.type == TokenType::IDENTIFIER) {
+        std::cout << "Identifier: " << token.value << std::endl;
+    } else if (token.type == TokenType::KEYWORD) {
+        std::cout << "Keyword: " << token.value << std::endl;
+    } else if (token.type == TokenType::INTEGER) {
+        std::cout << "Integer: " << token.value << std::endl;
+    } else if (token.type == TokenType::FLOAT) {
+        std::cout << "Float: " << token.value << std::endl;
+    } else if (token.type == TokenType::STRING) {
+        std::cout << "String: " << token.value << std::endl;
+    } else if (token.type == TokenType::BOOLEAN) {
+        std::cout << "Boolean: " << token.value << std::endl;
+    } else if (token.type == TokenType::NUL) {
+        std::cout << "Null: " << token.value << std::endl;
+    } else if (token.type == TokenType::OPERATOR) {
+        std::cout << "Operator: " << token.value << std::endl;
+    }
+    else if (token.type == TokenType::PUNCTUATION) {
+        std::cout << "Punctuation: " << token.value << std::endl;
+    } 
+    else if (token.type == TokenType::END_OF_FILE) {
+        std::cout << "End of file." << std::endl;
+    }
+    else {
+        std::cout << "(Map token type with id" << static_cast<int>(token.type) << "): " << token.value << std::endl;
+    }
+}
 
 void coutTokens(const std::list<Token>& tokens) {
 
     for (const auto& token : tokens) {
-
-        if (token.type == TokenType::COMMENT) {
-            std::cout << "Comment: " << token.value << std::endl;
-        }
-        else if (token.type == TokenType::IDENTIFIER) {
-            std::cout << "Identifier: " << token.value << std::endl;
-        } else if (token.type == TokenType::KEYWORD) {
-            std::cout << "Keyword: " << token.value << std::endl;
-        } else if (token.type == TokenType::INTEGER) {
-            std::cout << "Integer: " << token.value << std::endl;
-        } else if (token.type == TokenType::FLOAT) {
-            std::cout << "Float: " << token.value << std::endl;
-        } else if (token.type == TokenType::STRING) {
-            std::cout << "String: " << token.value << std::endl;
-        } else if (token.type == TokenType::BOOLEAN) {
-            std::cout << "Boolean: " << token.value << std::endl;
-        } else if (token.type == TokenType::NUL) {
-            std::cout << "Null: " << token.value << std::endl;
-        } else if (token.type == TokenType::OPERATOR) {
-            std::cout << "Operator: " << token.value << std::endl;
-        }
-        else if (token.type == TokenType::PUNCTUATION) {
-            std::cout << "Punctuation: " << token.value << std::endl;
-        } 
-        else if (token.type == TokenType::END_OF_FILE) {
-            std::cout << "End of file." << std::endl;
-        }
-        else {
-            std::cout << "(Map token type with id" << static_cast<int>(token.type) << "): " << token.value << std::endl;
-        }
+        coutToken(token);
     }
 }
 
@@ -57,16 +77,713 @@ std::string readFile(const std::string &filename) {
     return content;
 }
 
+// Prints winnowing fingerprints of the file, one "<hash> <offset>" per line
+int coutFingerprints(const std::string& filename, size_t k, size_t w) {
+
+    std::string sourceCode;
+    try {
+        sourceCode = readFile(filename);
+    } catch (const std::exception& e) {
+        std::cout << "Can't open the file, check it's name please." << std::endl;
+        return 1;
+    }
+
+    PHPLexer lexer;
+    TokenFingerprinter fingerprinter(k, w);
+
+    lexer.setSourceView(sourceCode);
+    fingerprinter.reset(sourceCode);
+    try {
+        lexer.getTokens(fingerprinter);
+    } catch (const LexerException& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    char hashStr[17];
+    for (const auto& fingerprint : fingerprinter.getFingerprints()) {
+        snprintf(hashStr, sizeof(hashStr), "%016llx", static_cast<unsigned long long>(fingerprint.hash));
+        std::cout << hashStr << " " << fingerprint.offset << "\n";
+    }
+    return 0;
+}
+
+// Sink only counting tokens
+class TokenCounter: public TokenSink {
+public:
+    size_t count = 0;
+
+    void onToken(const TokenView&) override {
+        count++;
+    }
+};
+
+// Lexes all .php files of the directory in parallel and prints the number of tokens of each file
+int coutDirectory(const std::string& directory) {
+
+    std::vector<std::string> files = collectPhpFiles(directory);
+    LexerPipeline pipeline;
+
+    std::vector<PHPLexer> lexers(pipeline.getLexerThreads());
+    std::vector<std::string> results(files.size());
+    std::atomic<size_t> totalTokens(0);
+
+    pipeline.run(files,
+        [&](size_t lexerIndex, size_t fileIndex, std::string_view sourceCode) {
+            PHPLexer& lexer = lexers[lexerIndex];
+            TokenCounter counter;
+            try {
+                lexer.setSourceView(sourceCode);
+                lexer.getTokens(counter);
+                results[fileIndex] = std::to_string(counter.count) + " tokens";
+                totalTokens += counter.count;
+            } catch (const LexerException& e) {
+                results[fileIndex] = e.what();
+            }
+        },
+        [&](size_t, size_t fileIndex) {
+            results[fileIndex] = "Can't open the file";
+        });
+
+    for (size_t i = 0; i < files.size(); i++) {
+        std::cout << files[i] << ": " << results[i] << "\n";
+    }
+    std::cout << "Files: " << files.size() << ", tokens: " << totalTokens << std::endl;
+    return 0;
+}
+
+// Lexes all .php files of the directory in parallel and prints aggregated statistics as JSON.
+// Tokens of a file with a lexer error are counted up to the error
+int coutSummary(const std::string& directory) {
+
+    std::vector<std::string> files = collectPhpFiles(directory);
+    LexerPipeline pipeline;
+
+    std::vector<PHPLexer> lexers(pipeline.getLexerThreads());
+    std::vector<CorpusSummary> summaries(pipeline.getLexerThreads());
+
+    pipeline.run(files,
+        [&](size_t lexerIndex, size_t, std::string_view sourceCode) {
+            CorpusSummary& summary = summaries[lexerIndex];
+            summary.addFile(sourceCode.length());
+            try {
+                lexers[lexerIndex].setSourceView(sourceCode);
+                lexers[lexerIndex].getTokens(summary);
+            } catch (const LexerException& e) {
+                summary.addLexerError();
+            }
+        },
+        [&](size_t lexerIndex, size_t) {
+            summaries[lexerIndex].addUnreadableFile();
+        });
+
+    for (size_t i = 1; i < summaries.size(); i++) {
+        summaries[0].merge(summaries[i]);
+    }
+    std::cout << summaries[0].toJson() << std::endl;
+    return 0;
+}
+
+// Allocation metrics of lexing the code, names of the metrics are mapped to their values.
+// Per MB values are scaled to 1 MB of the code
+std::map<std::string, double> measureAllocations(const std::string& sourceCode) {
+
+    std::map<std::string, double> metrics;
+    double megabytes = sourceCode.length() / (1024.0 * 1024.0);
+
+    const int MAX_SCOPES = 64;
+    AllocationScopeStats scopesBefore[MAX_SCOPES] = {};
+    AllocationScopeStats scopesAfter[MAX_SCOPES] = {};
+
+    // Runs the lexing and adds its metrics with the prefix
+    auto measure = [&](const std::string& prefix, const std::function<void()>& lexing) {
+
+        int scopesCount = getAllocationScopeStats(scopesBefore, MAX_SCOPES);
+        resetAllocationPeak();
+        AllocationStats before = getAllocationStats();
+
+        lexing();
+
+        AllocationStats after = getAllocationStats();
+        metrics[prefix + ".allocationsPerMB"] = (after.allocations - before.allocations) / megabytes;
+        metrics[prefix + ".bytesPerMB"] = (after.bytes - before.bytes) / megabytes;
+        metrics[prefix + ".peakLiveBytesPerMB"] = (after.peakLiveBytes - before.liveBytes) / megabytes;
+
+        // Scopes are registered on the first use, so the new ones have zero "before" values
+        int scopesAfterCount = getAllocationScopeStats(scopesAfter, MAX_SCOPES);
+        for (int i = 0; i < scopesAfterCount; i++) {
+            uint64_t allocations = scopesAfter[i].allocations - (i < scopesCount ? scopesBefore[i].allocations : 0);
+            metrics[prefix + ".scope." + scopesAfter[i].name + ".allocationsPerMB"] = allocations / megabytes;
+        }
+    };
+
+    measure("list", [&]() {
+        PHPLexer lexer;
+        lexer.setSourceCode(sourceCode);
+        std::list<Token> tokens = lexer.getTokens();
+    });
+
+    PHPLexer lexer;
+    std::vector<TokenView> tokens;
+    measure("views", [&]() {
+        lexer.setSourceView(sourceCode);
+        lexer.getTokens(tokens);
+    });
+    // Lexing again with the same vector, shouldn't allocate at all
+    measure("viewsReused", [&]() {
+        lexer.setSourceView(sourceCode);
+        lexer.getTokens(tokens);
+    });
+
+    return metrics;
+}
+
+// Prints allocation metrics of lexing the file (repeated up to 1 MB to hide fixed costs).
+// If the baseline file is given, fails when a metric is more than 10% worse than in the baseline,
+// if the baseline file doesn't exist, it's created from the current metrics
+int coutAllocationProfile(const std::string& filename, const std::string& baselineFilename) {
+
+    if (!ALLOCATION_PROFILING_ENABLED) {
+        std::cout << "Allocation profiling is off, recompile with -DLEXER_PROFILE_ALLOCATIONS" << std::endl;
+        return 1;
+    }
+
+    std::string sourceCode;
+    try {
+        std::string fileCode = readFile(filename);
+        if (fileCode.empty()) {
+            std::cout << "The file is empty" << std::endl;
+            return 1;
+        }
+        while (sourceCode.length() < 1024 * 1024) {
+            sourceCode += fileCode;
+            sourceCode += '\n';
+        }
+    } catch (const std::exception& e) {
+        std::cout << "Can't open the file, check it's name please." << std::endl;
+        return 1;
+    }
+
+    std::map<std::string, double> metrics;
+    try {
+        metrics = measureAllocations(sourceCode);
+    } catch (const LexerException& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    for (const auto& metric : metrics) {
+        std::cout << metric.first << " " << std::llround(metric.second) << "\n";
+    }
+
+    if (baselineFilename.empty()) {
+        return 0;
+    }
+
+    std::ifstream baselineFile(baselineFilename);
+    if (!baselineFile.is_open()) {
+        std::ofstream newBaselineFile(baselineFilename);
+        for (const auto& metric : metrics) {
+            newBaselineFile << metric.first << " " << std::llround(metric.second) << "\n";
+        }
+        std::cout << "Baseline is written to " << baselineFilename << std::endl;
+        return 0;
+    }
+
+    bool isRegressed = false;
+    std::string name;
+    double baseline;
+    while (baselineFile >> name >> baseline) {
+        double current = metrics.count(name) ? metrics[name] : 0;
+        // One allocation per MB of slack to not fail on rounding
+        if (current > baseline * 1.1 + 1) {
+            std::cout << "Regression: " << name << " is " << std::llround(current) << ", baseline is " << baseline << std::endl;
+            isRegressed = true;
+        }
+    }
+
+    if (isRegressed) {
+        return 1;
+    }
+    std::cout << "No regressions against " << baselineFilename << std::endl;
+    return 0;
+}
+
+// Sends requests for the file to a LexerServer thread over a socket pair (as an editor integration does),
+// prints percentiles of the round trip times. Fails (exit code 1) if p99 isn't below MAX_P99_MS
+int coutServerLatency(const std::string& filename, size_t requestCount) {
+
+    const double MAX_P99_MS = 1.0;
+    const size_t WARMUP_REQUESTS = 100;
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        return 1;
+    }
+    std::thread server(LexerServer::serveConnection, fds[1]);
+
+    std::string request;
+    appendUint32(request, filename.length() + 2);
+    request += "pb" + filename;
+    std::string reply;
+    std::vector<double> times;
+    bool isReplyValid = true;
+
+    for (size_t i = 0; i < WARMUP_REQUESTS + requestCount && isReplyValid; i++) {
+        auto start = std::chrono::steady_clock::now();
+        unsigned char lengthBytes[4];
+        isReplyValid = writeAll(fds[0], request.data(), request.length())
+            && readExactly(fds[0], reinterpret_cast<char*>(lengthBytes), 4);
+        if (isReplyValid) {
+            uint32_t length = lengthBytes[0] | (lengthBytes[1] << 8) | (lengthBytes[2] << 16) | (static_cast<uint32_t>(lengthBytes[3]) << 24);
+            reply.resize(length);
+            isReplyValid = length > 0 && readExactly(fds[0], &reply[0], length) && reply[0] == 0;
+        }
+        if (i >= WARMUP_REQUESTS) {
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+
+    close(fds[0]); // The server sees the end of stream and stops
+    server.join();
+    if (!isReplyValid) {
+        std::cout << "The server failed to lex " << filename << std::endl;
+        return 1;
+    }
+
+    std::sort(times.begin(), times.end());
+    auto percentile = [&](double p) { return times[std::min(times.size() - 1, static_cast<size_t>(p * times.size()))]; };
+    char line[256];
+    snprintf(line, sizeof(line), "%zu requests: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms",
+        times.size(), percentile(0.5), percentile(0.9), percentile(0.99), times.back());
+    std::cout << line << std::endl;
+    if (percentile(0.99) >= MAX_P99_MS) {
+        std::cout << "p99 is above " << MAX_P99_MS << " ms" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Lexes the file checking it to be valid UTF-8, prints offsets of invalid sequences and the tokens
+int coutUtf8Check(const std::string& filename) {
+
+    std::string sourceCode;
+    try {
+        sourceCode = readFile(filename);
+    } catch (const std::exception& e) {
+        std::cout << "Can't open the file, check it's name please." << std::endl;
+        return 1;
+    }
+
+    PHPLexer lexer;
+    lexer.setUtf8Validation(true);
+    lexer.setSourceCode(sourceCode);
+    std::list<Token> tokens = lexer.getTokens();
+
+    for (size_t offset : lexer.getInvalidUtf8Offsets()) {
+        std::cout << "Invalid UTF-8 at offset: " << offset << std::endl;
+    }
+    coutTokens(tokens);
+
+    return lexer.getInvalidUtf8Offsets().empty() ? 0 : 1;
+}
+
+// Counts lines up to the offsets, offsets must not decrease between calls
+class LineCounter {
+private:
+    std::string_view sourceCode;
+    size_t countedTo = 0;
+    size_t line = 1;
+public:
+    explicit LineCounter(std::string_view code) : sourceCode(code) {}
+
+    size_t lineAt(size_t offset) {
+        for (; countedTo < offset; countedTo++) {
+            if (sourceCode[countedTo] == '\n') {
+                line++;
+            }
+        }
+        return line;
+    }
+};
+
+// Prints the top level bracketed regions of the file (jumping over their content) and unbalanced brackets
+int coutOutline(const std::string& filename) {
+
+    std::string sourceCode;
+    try {
+        sourceCode = readFile(filename);
+    } catch (const std::exception& e) {
+        std::cout << "Can't open the file, check it's name please." << std::endl;
+        return 1;
+    }
+
+    PHPLexer lexer;
+    std::vector<TokenView> tokens;
+    BracketIndex brackets;
+    try {
+        lexer.setSourceView(sourceCode);
+        lexer.getTokens(tokens, brackets);
+    } catch (const LexerException& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    auto offsetOf = [&](size_t tokenIndex) {
+        return static_cast<size_t>(tokens[tokenIndex].value.data() - sourceCode.data());
+    };
+
+    LineCounter lines(sourceCode);
+    for (size_t i = 0; i < tokens.size(); i++) {
+        size_t match = brackets.matches[i];
+        if (match != BracketIndex::NO_MATCH && match > i) {
+            size_t startLine = lines.lineAt(offsetOf(i));
+            size_t endLine = lines.lineAt(offsetOf(match));
+            std::cout << "Lines " << startLine << "-" << endLine << ": "
+                << tokens[i].value << " ... " << tokens[match].value
+                << " (tokens " << i << "-" << match << ")" << std::endl;
+            i = match; // Jumping over the region
+        }
+    }
+
+    LineCounter unbalancedLines(sourceCode);
+    for (size_t tokenIndex : brackets.unbalanced) {
+        std::cout << "Unbalanced " << tokens[tokenIndex].value
+            << " at line " << unbalancedLines.lineAt(offsetOf(tokenIndex)) << std::endl;
+    }
+
+    return brackets.unbalanced.empty() ? 0 : 1;
+}
+
+// Lexes the file on a separate thread, printing tokens as their batches arrive
+int coutTokensPipelined(const std::string& filename) {
+
+    std::string sourceCode;
+    try {
+        sourceCode = readFile(filename);
+    } catch (const std::exception& e) {
+        std::cout << "Can't open the file, check it's name please." << std::endl;
+        return 1;
+    }
+
+    ConcurrentLexer lexer;
+    lexer.start(sourceCode);
+
+    const TokenView* tokens;
+    size_t count;
+    try {
+        while (lexer.nextBatch(tokens, count)) {
+            for (size_t i = 0; i < count; i++) {
+                coutToken(tokens[i]);
+            }
+        }
+    } catch (const LexerException& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Prints file:line of tokens matching the predicates in the file or in all .php files of the directory
+int coutFoundTokens(const std::string& path, const std::vector<std::string>& predicateTexts) {
+
+    std::vector<TokenPredicate> predicates(predicateTexts.size());
+    for (size_t i = 0; i < predicateTexts.size(); i++) {
+        if (!parseTokenPredicate(predicateTexts[i], predicates[i])) {
+            std::cout << "Wrong predicate: " << predicateTexts[i] << " (expected <type>:<value> or <type>:<prefix>*)" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::string> files;
+    if (std::filesystem::is_directory(path)) {
+        files = collectPhpFiles(path);
+    } else {
+        files.push_back(path);
+    }
+
+    LexerPipeline pipeline;
+    std::vector<TokenFinder> finders(pipeline.getLexerThreads(), TokenFinder(predicates));
+    std::vector<std::vector<TokenHit>> hits(pipeline.getLexerThreads());
+    // Printed lines of each file, files are printed in the order of their paths
+    std::vector<std::string> outputs(files.size());
+
+    pipeline.run(files,
+        [&](size_t lexerIndex, size_t fileIndex, std::string_view sourceCode) {
+            std::vector<TokenHit>& fileHits = hits[lexerIndex];
+            fileHits.clear();
+            finders[lexerIndex].find(sourceCode, fileHits);
+            for (const auto& hit : fileHits) {
+                outputs[fileIndex] += files[fileIndex] + ":" + std::to_string(hit.line) + ": ";
+                outputs[fileIndex].append(hit.value.data(), hit.value.length());
+                outputs[fileIndex] += '\n';
+            }
+        },
+        [&](size_t, size_t fileIndex) {
+            outputs[fileIndex] = "Can't open the file " + files[fileIndex] + "\n";
+        });
+
+    bool isFound = false;
+    for (const auto& output : outputs) {
+        std::cout << output;
+        isFound = isFound || !output.empty();
+    }
+    return isFound ? 0 : 1;
+}
+
+// Writes the code of the file without comments and extra whitespace to stdout or to the output file
+int writeMinified(const std::string& filename, const std::string& outputFilename) {
+
+    std::string sourceCode;
+    try {
+        sourceCode = readFile(filename);
+    } catch (const std::exception& e) {
+        std::cout << "Can't open the file, check it's name please." << std::endl;
+        return 1;
+    }
+
+    PHPLexer lexer;
+    CodeMinifier minifier;
+    minifier.reset(sourceCode);
+    try {
+        lexer.setSourceView(sourceCode);
+        lexer.getTokens(minifier);
+    } catch (const LexerException& e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    std::string_view output = minifier.getOutput();
+    if (outputFilename.empty()) {
+        std::cout.write(output.data(), output.length());
+        return 0;
+    }
+
+    std::ofstream file(outputFilename, std::ios::binary);
+    file.write(output.data(), output.length());
+    if (!file) {
+        std::cout << "Can't write the file " << outputFilename << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Keeps tokens of the directory up to date and answers queries from stdin (or the unix socket) until its end
+int serveWatchedTree(const std::string& directory, const std::string& socketPath) {
+
+    if (!std::filesystem::is_directory(directory)) {
+        std::cout << "Not a directory: " << directory << std::endl;
+        return 1;
+    }
+
+    TreeWatcher watcher(directory);
+    if (!watcher.start()) {
+        return 1;
+    }
+    // Stdout carries the replies, so the progress goes to stderr
+    std::cerr << "Watching " << directory << ": " << watcher.query("stats") << std::endl;
+
+    if (!socketPath.empty()) {
+        return watcher.serveSocket(socketPath);
+    }
+    watcher.serveQueries(STDIN_FILENO, STDOUT_FILENO);
+    return 0;
+}
+
+// Builds the index of identifiers and keywords of the directory, or brings the existing one up to date
+int buildTokenIndex(const std::string& directory, const std::string& indexPath) {
+
+    if (!std::filesystem::is_directory(directory)) {
+        std::cout << "Not a directory: " << directory << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    TokenIndexBuilder builder;
+    TokenIndexBuilder::Stats stats;
+    if (!builder.build(directory, indexPath, stats)) {
+        return 1;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << (stats.isWritten ? "Indexed " : "Up to date, ") << stats.files << " files ("
+        << stats.lexedFiles << " lexed, " << stats.unchangedFiles << " unchanged, " << stats.errorFiles << " with errors), "
+        << stats.terms << " values, " << stats.bytes << " bytes in " << ms << " ms" << std::endl;
+    return 0;
+}
+
+// Prints file:line of the tokens with the values (or value prefixes ending with *) found in the index
+int coutIndexLookup(const std::string& indexPath, const std::vector<std::string>& values) {
+
+    MappedTokenIndex index;
+    if (!index.open(indexPath)) {
+        std::cout << "Can't open the index " << indexPath << " (build it with --index)" << std::endl;
+        return 1;
+    }
+
+    struct Hit {
+        uint32_t file;
+        uint64_t offset;
+        uint64_t line;
+        std::string_view value;
+    };
+    std::vector<Hit> hits;
+
+    for (const auto& text : values) {
+        bool isPrefix = text.length() > 1 && text.back() == '*';
+        std::string_view value(text.data(), text.length() - (isPrefix ? 1 : 0));
+
+        for (size_t term = index.lowerBound(value); term < index.getTermCount(); term++) {
+            std::string_view termValue = index.getTermValue(term);
+            if (isPrefix ? termValue.substr(0, value.length()) != value : termValue != value) {
+                break;
+            }
+            bool isValid = index.forEachPosting(term, [&](uint32_t file, uint64_t offset, uint64_t line) {
+                hits.push_back(Hit{file, offset, line, termValue});
+            });
+            if (!isValid) {
+                std::cout << "The index " << indexPath << " is broken, rebuild it from scratch" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // Same order as --find prints: by file, then by position in the file
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+        return a.file != b.file ? a.file < b.file : a.offset < b.offset;
+    });
+    hits.erase(std::unique(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+        return a.file == b.file && a.offset == b.offset;
+    }), hits.end());
+
+    for (const auto& hit : hits) {
+        std::cout << index.getPath(hit.file) << ":" << hit.line << ": " << hit.value << '\n';
+    }
+    std::cout.flush();
+    return hits.empty() ? 1 : 0;
+}
+
+void coutUsage() {
+    std::cout << "PHPLexerRunner usage:" << std::endl 
+        << "\tExample: ./LexerRunner --code '$var1 = \"test\"' " << std::endl
+        << "Options:" << std::endl
+        << "\t1) [-f | --filename] <filename>" << std::endl
+        << "\t2) [-c | --code] <source code>" << std::endl
+        << "\t1) [-d | --debug]" << std::endl
+        << "\t4) [-s | --serve] [socket path] (serves length-prefixed requests from stdin or the unix socket)" << std::endl
+        << "\t5) [-p | --fingerprint] <filename> [k] [w] (prints winnowing fingerprints of k-token grams)" << std::endl
+        << "\t6) [-r | --directory] <directory> (lexes all .php files of the directory in parallel)" << std::endl
+        << "\t7) [-m | --summary] <directory> (prints token statistics of the directory as JSON)" << std::endl
+        << "\t8) [-a | --alloc-profile] <filename> [baseline] (allocation metrics, needs -DLEXER_PROFILE_ALLOCATIONS build)" << std::endl
+        << "\t9) [-u | --check-utf8] <filename> (reports invalid UTF-8, then prints tokens)" << std::endl
+        << "\t10) [-o | --outline] <filename> (prints top level bracketed regions and unbalanced brackets)" << std::endl
+        << "\t11) [-l | --pipelined] <filename> (lexes on a separate thread while printing)" << std::endl
+        << "\t12) [-n | --find] <filename | directory> <type>:<value>[*]... (prints file:line of matching tokens)" << std::endl
+        << "\t13) [-w | --strip] <filename> [output] (writes the code without comments and extra whitespace)" << std::endl
+        << "\t14) [-b | --adversarial] (checks linear time and bounded memory of lexing pathological inputs)" << std::endl
+        << "\t15) [-t | --watch] <directory> [socket path] (keeps tokens of the directory up to date, answers queries)" << std::endl
+        << "\t16) [-x | --index] <directory> <index file> (builds or updates the index of identifiers and keywords)" << std::endl
+        << "\t17) [-k | --lookup] <index file> <value>[*]... (prints file:line of the values using the index)" << std::endl
+        << "\t18) [-y | --serve-latency] <filename> [requests] (checks p99 latency of --serve requests for the file)" << std::endl;
+}
+
+// Parses a positive decimal number, returns false for anything else (text, 0, a negative or too big number)
+bool parsePositive(const char* text, size_t& value) {
+    if (*text < '0' || *text > '9') {
+        return false;
+    }
+    char* end;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed == 0 || parsed > SIZE_MAX) {
+        return false;
+    }
+    value = static_cast<size_t>(parsed);
+    return true;
+}
 
 int main(int argc, char *argv[]) {
 
+    if (argc >= 2 && argc <= 3 && (std::string(argv[1]) == "--serve" || std::string(argv[1]) == "-s")) {
+        LexerServer server;
+        if (argc == 3) {
+            return server.serveSocket(argv[2]);
+        }
+        return server.serveStdin();
+    }
+
+    if (argc >= 3 && argc <= 5 && (std::string(argv[1]) == "--fingerprint" || std::string(argv[1]) == "-p")) {
+        size_t k = 5;
+        size_t w = 4;
+        if ((argc >= 4 && !parsePositive(argv[3], k)) || (argc >= 5 && !parsePositive(argv[4], w))) {
+            std::cout << "k and w must be positive numbers" << std::endl;
+            coutUsage();
+            return 1;
+        }
+        return coutFingerprints(argv[2], k, w);
+    }
+
+    if (argc == 3 && (std::string(argv[1]) == "--directory" || std::string(argv[1]) == "-r")) {
+        return coutDirectory(argv[2]);
+    }
+
+    if (argc == 3 && (std::string(argv[1]) == "--summary" || std::string(argv[1]) == "-m")) {
+        return coutSummary(argv[2]);
+    }
+
+    if (argc >= 3 && argc <= 4 && (std::string(argv[1]) == "--alloc-profile" || std::string(argv[1]) == "-a")) {
+        return coutAllocationProfile(argv[2], argc == 4 ? argv[3] : "");
+    }
+
+    if (argc >= 3 && argc <= 4 && (std::string(argv[1]) == "--serve-latency" || std::string(argv[1]) == "-y")) {
+        size_t requestCount = 10000;
+        if (argc == 4 && !parsePositive(argv[3], requestCount)) {
+            coutUsage();
+            return 1;
+        }
+        return coutServerLatency(argv[2], requestCount);
+    }
+
+    if (argc == 3 && (std::string(argv[1]) == "--check-utf8" || std::string(argv[1]) == "-u")) {
+        return coutUtf8Check(argv[2]);
+    }
+
+    if (argc == 3 && (std::string(argv[1]) == "--outline" || std::string(argv[1]) == "-o")) {
+        return coutOutline(argv[2]);
+    }
+
+    if (argc == 3 && (std::string(argv[1]) == "--pipelined" || std::string(argv[1]) == "-l")) {
+        return coutTokensPipelined(argv[2]);
+    }
+
+    if (argc >= 4 && (std::string(argv[1]) == "--find" || std::string(argv[1]) == "-n")) {
+        return coutFoundTokens(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+
+    if (argc >= 3 && argc <= 4 && (std::string(argv[1]) == "--strip" || std::string(argv[1]) == "-w")) {
+        return writeMinified(argv[2], argc == 4 ? argv[3] : "");
+    }
+
+    if (argc == 2 && (std::string(argv[1]) == "--adversarial" || std::string(argv[1]) == "-b")) {
+        AdversarialBenchmark benchmark;
+        return benchmark.run(std::cout) ? 0 : 1;
+    }
+
+    if (argc >= 3 && argc <= 4 && (std::string(argv[1]) == "--watch" || std::string(argv[1]) == "-t")) {
+        return serveWatchedTree(argv[2], argc == 4 ? argv[3] : "");
+    }
+
+    if (argc == 4 && (std::string(argv[1]) == "--index" || std::string(argv[1]) == "-x")) {
+        return buildTokenIndex(argv[2], argv[3]);
+    }
+
+    if (argc >= 4 && (std::string(argv[1]) == "--lookup" || std::string(argv[1]) == "-k")) {
+        return coutIndexLookup(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+
     if (argc == 1 || argc > 3) {
-        std::cout << "PHPLexerRunner usage:" << std::endl 
-            << "\tExample: ./LexerRunner --code '$var1 = \"test\"' " << std::endl
-            << "Options:" << std::endl
-            << "\t1) [-f | --filename] <filename>" << std::endl
-            << "\t2) [-c | --code] <source code>" << std::endl
-            << "\t1) [-d | --debug]" << std::endl;
+        coutUsage();
         return 0;
     } 
     else if (argc == 3) {
@@ -0,0 +1,353 @@
+#ifndef LEXER_SERVER_H
+#define LEXER_SERVER_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "PHPLexer.h"
+#include "JsonUtils.h"
+
+// Long running lexer server used by the --serve mode of LexerRunner.
+// Keeps a warm PHPLexer and reusable buffers per connection, so editor integrations
+// and hooks don't pay process startup for every file.
+//
+// Protocol (all integers are 4 byte little-endian):
+//     Request: <length> <kind> <format> <payload>
+//         kind    - 'p' if payload is a path to the file, 'c' if payload is the source code itself,
+//                   'v' for the protocol version (payload is ignored)
+//         format  - 'j' for JSON reply, 'b' for binary reply
+//         length  - number of bytes after the length field (kind + format + payload)
+//     Reply: <length> <body>
+//         JSON body:   {"tokens":[{"type":"IDENTIFIER","value":"$a"},...]} or {"error":"..."}
+//                      {"version":N} for 'v'
+//         Binary body: <status 0> <token count> then per token <type byte> <subtype byte> <value length> <value>
+//                      or <status 1> <error message>
+//                      <status 0> <version> for 'v'
+// Requests of one connection (or stdin) are handled in order,
+// different socket connections are handled concurrently, up to MAX_CONNECTIONS at once.
+
+// Changes when replies change incompatibly.
+// 2: binary tokens carry the subtype (TokenSubtype of PHPLexer.h) after the type
+const uint32_t PROTOCOL_VERSION = 2;
+
+// Requests bigger than that are treated as broken
+const uint32_t MAX_REQUEST_LENGTH = 64 * 1024 * 1024;
+
+// Connections served at once, further clients wait in the listen backlog until one ends
+const size_t MAX_CONNECTIONS = 64;
+
+inline void appendUint32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+// Reads exactly length bytes, returns false on the end of stream or an error
+inline bool readExactly(int fd, char* buffer, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = read(fd, buffer + done, length - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+// Writes the whole buffer, returns false if the peer is gone (EPIPE) or on another error
+inline bool writeAll(int fd, const char* buffer, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = write(fd, buffer + done, length - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+// Binds the unix domain socket (replacing a stale one) and starts listening on it.
+// Returns the listening descriptor, or -1 after printing the error
+inline int listenUnixSocket(const std::string& socketPath) {
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.length() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long: " << socketPath << std::endl;
+        return -1;
+    }
+    socketPath.copy(address.sun_path, socketPath.length());
+
+    // A client disconnecting before reading its reply must fail the write with EPIPE, not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    unlink(socketPath.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        perror("bind");
+        close(listenFd);
+        return -1;
+    }
+    if (listen(listenFd, 64) < 0) {
+        perror("listen");
+        close(listenFd);
+        return -1;
+    }
+    return listenFd;
+}
+
+// Accepts connections until accept() fails, each one is served by serve(fd) in its own thread.
+// At most maxConnections threads run at once: when all are busy, the loop waits for one to end
+// before accepting, so a flood of clients can't start threads without a bound
+template <typename Serve>
+void acceptConnections(int listenFd, size_t maxConnections, Serve serve) {
+
+    // Shared with the detached threads, which may end after the loop
+    struct Slots {
+        std::mutex mutex;
+        std::condition_variable released;
+        size_t used = 0;
+    };
+    auto slots = std::make_shared<Slots>();
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(slots->mutex);
+            slots->released.wait(lock, [&]() { return slots->used < maxConnections; });
+        }
+
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("accept");
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(slots->mutex);
+            slots->used++;
+        }
+        std::thread([slots, serve, fd]() {
+            serve(fd);
+            std::lock_guard<std::mutex> lock(slots->mutex);
+            slots->used--;
+            slots->released.notify_one();
+        }).detach();
+    }
+}
+
+class LexerServer
+{
+private:
+
+    // State of a single connection, reused between its requests
+    struct Session {
+        int inFd;
+        int outFd;
+        PHPLexer lexer;
+        std::string request;
+        std::string sourceCode;
+        std::vector<TokenView> tokens;
+        std::string reply;
+    };
+
+    // Reads the whole file into the buffer keeping its capacity
+    static bool readFileInto(const std::string& filename, std::string& buffer) {
+        FILE* file = fopen(filename.c_str(), "rb");
+        if (file == nullptr) {
+            return false;
+        }
+
+        buffer.clear();
+        char chunk[64 * 1024];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            buffer.append(chunk, n);
+        }
+        fclose(file);
+        return true;
+    }
+
+    static void buildErrorReply(std::string& reply, char format, const std::string& message) {
+        if (format == 'b') {
+            reply += '\1';
+            reply += message;
+        } else {
+            reply += "{\"error\":";
+            appendJsonString(reply, message);
+            reply += "}";
+        }
+    }
+
+    static void buildTokensReply(std::string& reply, char format, const std::vector<TokenView>& tokens) {
+        if (format == 'b') {
+            reply += '\0';
+            appendUint32(reply, tokens.size());
+            for (const auto& token : tokens) {
+                reply += static_cast<char>(token.type);
+                reply += static_cast<char>(token.subtype);
+                appendUint32(reply, token.value.length());
+                reply += token.value;
+            }
+        } else {
+            reply += "{\"tokens\":[";
+            bool first = true;
+            for (const auto& token : tokens) {
+                if (!first) {
+                    reply += ',';
+                }
+                first = false;
+                reply += "{\"type\":\"";
+                reply += tokenTypeName(token.type);
+                reply += "\",\"value\":";
+                appendJsonString(reply, token.value);
+                reply += '}';
+            }
+            reply += "]}";
+        }
+    }
+
+    // Handles one request which is already read into session.request
+    static void handleRequest(Session& session) {
+
+        std::string& request = session.request;
+        std::string& reply = session.reply;
+
+        // Reserving the place for the reply length
+        reply.assign(4, '\0');
+
+        char format = request.length() >= 2 ? request[1] : 'j';
+        if (request.length() < 2 || (request[0] != 'p' && request[0] != 'c' && request[0] != 'v')
+            || (format != 'j' && format != 'b')) {
+            buildErrorReply(reply, format == 'b' ? 'b' : 'j', "Malformed request");
+        }
+        else if (request[0] == 'v') {
+            if (format == 'b') {
+                reply += '\0';
+                appendUint32(reply, PROTOCOL_VERSION);
+            } else {
+                reply += "{\"version\":" + std::to_string(PROTOCOL_VERSION) + "}";
+            }
+        }
+        else {
+            bool sourceIsRead = true;
+            std::string_view sourceCode;
+            if (request[0] == 'p') {
+                sourceIsRead = readFileInto(request.substr(2), session.sourceCode);
+                sourceCode = session.sourceCode;
+            } else {
+                // Lexing the code right in the request buffer
+                sourceCode = std::string_view(request).substr(2);
+            }
+
+            if (!sourceIsRead) {
+                buildErrorReply(reply, format, "Can't open the file");
+            } else {
+                try {
+                    session.lexer.setSourceView(sourceCode);
+                    session.lexer.getTokens(session.tokens);
+                    buildTokensReply(reply, format, session.tokens);
+                } catch (const LexerException& e) {
+                    reply.resize(4);
+                    buildErrorReply(reply, format, e.what());
+                }
+            }
+        }
+
+        uint32_t length = reply.length() - 4;
+        for (int i = 0; i < 4; i++) {
+            reply[i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+        }
+    }
+
+    // Serves requests from inFd until the end of the stream
+    static void serveSession(Session& session) {
+
+        unsigned char lengthBytes[4];
+
+        while (readExactly(session.inFd, reinterpret_cast<char*>(lengthBytes), 4)) {
+
+            uint32_t length = lengthBytes[0] | (lengthBytes[1] << 8) | (lengthBytes[2] << 16)
+                | (static_cast<uint32_t>(lengthBytes[3]) << 24);
+
+            if (length > MAX_REQUEST_LENGTH) {
+                std::cerr << "Request is too big: " << length << " bytes" << std::endl;
+                return;
+            }
+
+            session.request.resize(length);
+            if (!readExactly(session.inFd, &session.request[0], length)) {
+                return;
+            }
+
+            handleRequest(session);
+
+            if (!writeAll(session.outFd, session.reply.data(), session.reply.length())) {
+                return;
+            }
+        }
+    }
+
+public:
+
+    // Serves requests of the connected socket until the peer closes it, then closes the socket
+    static void serveConnection(int fd) {
+        Session session;
+        session.inFd = fd;
+        session.outFd = fd;
+        serveSession(session);
+        close(fd);
+    }
+
+    // Serves requests coming from stdin, replies are written to stdout
+    int serveStdin() {
+        Session session;
+        session.inFd = STDIN_FILENO;
+        session.outFd = STDOUT_FILENO;
+        serveSession(session);
+        return 0;
+    }
+
+    // Listens on the unix domain socket, each connection is served in its own thread
+    int serveSocket(const std::string& socketPath) {
+
+        int listenFd = listenUnixSocket(socketPath);
+        if (listenFd < 0) {
+            return 1;
+        }
+
+        acceptConnections(listenFd, MAX_CONNECTIONS, serveConnection);
+
+        close(listenFd);
+        return 1;
+    }
+};
+
+#endif
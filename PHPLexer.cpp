@@ -1,903 +1,1025 @@
 #include <iostream>
-#include <string>
-#include <list>
-
-
-enum class TokenType {
-    COMMENT,
-    KEYWORD,
-    OPERATOR,
-    IDENTIFIER,
-    PUNCTUATION,
-    INTEGER,
-    FLOAT,
-    STRING,
-    BOOLEAN,
-    // Named so because NULL is a name in C++
-    NUL,
-    END_OF_FILE
+#include <algorithm>
+#include <iterator>
+#include "PHPLexer.h"
+#include "Utf8Validator.h"
+#include "AllocationProfiler.h"
+
+const char* tokenTypeName(TokenType type) {
+    switch (type) {
+        case TokenType::COMMENT: return "COMMENT";
+        case TokenType::KEYWORD: return "KEYWORD";
+        case TokenType::OPERATOR: return "OPERATOR";
+        case TokenType::IDENTIFIER: return "IDENTIFIER";
+        case TokenType::PUNCTUATION: return "PUNCTUATION";
+        case TokenType::INTEGER: return "INTEGER";
+        case TokenType::FLOAT: return "FLOAT";
+        case TokenType::STRING: return "STRING";
+        case TokenType::BOOLEAN: return "BOOLEAN";
+        case TokenType::NUL: return "NUL";
+        case TokenType::END_OF_FILE: return "END_OF_FILE";
+    }
+    return "UNKNOWN";
+}
+
+// Indexed by TokenSubtype
+static const char* const subtypeSpellings[] = {
+    "",
+    "if", "else",
+    "do", "while", "for", "foreach", "break", "continue",
+    "function", "return", "echo",
+    "and", "or", "xor",
+    "+", "-", "*", "/", "%", ".",
+    "+=", "-=", "*=",
+    "/=", "%=", ".=",
+    "=", "==", "===",
+    "!", "!=", "!==",
+    "<", "<=", "<=>", "<<", "<>",
+    ">", ">=", ">>",
+    "&", "&&", "|", "||",
+    "^", "~", ":", "@",
+    "?", "??",
+    ";", ",",
+    "::", "=>", "->", "?->",
+    "...",
+    "(", ")",
+    "[", "]",
+    "{", "}",
+    "true", "false",
+    "NULL"
 };
 
-struct Token{    
-    TokenType type;
-    std::string value;
+static_assert(sizeof(subtypeSpellings) / sizeof(subtypeSpellings[0]) == static_cast<size_t>(TokenSubtype::COUNT),
+    "Every token subtype must have a spelling");
 
-    Token(TokenType t, const std::string& v) : type(t), value(v){}
+const char* tokenSubtypeSpelling(TokenSubtype subtype) {
+    if (subtype >= TokenSubtype::COUNT) {
+        return "";
+    }
+    return subtypeSpellings[static_cast<size_t>(subtype)];
+}
+
+void VectorTokenSink::onToken(const TokenView& token) {
+    LEXER_ALLOCATION_SCOPE("VectorTokenSink");
+    tokens.push_back(token);
+}
+
+// Subtype following the given one by the offset, for lexemes listed in the order of their subtypes
+static TokenSubtype addToSubtype(TokenSubtype subtype, int offset) {
+    return static_cast<TokenSubtype>(static_cast<int>(subtype) + offset);
+}
+
+// Subtypes of PHPLexer::keywords and PHPLexer::keywordOperators by position. They are listed instead of
+// counted from the first one, so a keyword added to the lists gets a new ID and the others keep theirs
+static const TokenSubtype keywordSubtypes[] = {
+    TokenSubtype::KEYWORD_IF, TokenSubtype::KEYWORD_ELSE,
+    TokenSubtype::KEYWORD_DO, TokenSubtype::KEYWORD_WHILE, TokenSubtype::KEYWORD_FOR, TokenSubtype::KEYWORD_FOREACH,
+    TokenSubtype::KEYWORD_BREAK, TokenSubtype::KEYWORD_CONTINUE,
+    TokenSubtype::KEYWORD_FUNCTION, TokenSubtype::KEYWORD_RETURN, TokenSubtype::KEYWORD_ECHO
 };
-
-// Custom exception
-class LexerException: public std::runtime_error {
-public:
-    explicit LexerException(const std::string& message) 
-    : runtime_error(message) { }
+static const TokenSubtype keywordOperatorSubtypes[] = {
+    TokenSubtype::OPERATOR_AND, TokenSubtype::OPERATOR_OR, TokenSubtype::OPERATOR_XOR
 };
 
-// Class reads sourceCode of PHP script and translates it into tokens,
-// giving tokens types and values (original)
-// Usage: first call setSourceCode method, then retrieve tokens via getTokens() method
-class PHPLexer
-{
-private:
-    std::string sourceCode;
-    size_t curPos; // Currect position
-    size_t line; // Number of lines
-    size_t sourceCodelength; // Extracted to evoid multiple invoking sourceCode.length()
-    bool trace = false; // If true, prints debug information
-
-    // List of all keywords
-    std::string keywords[11] = {
-         "if", "else",
-         "do", "while", "for", "foreach", "break", "continue",
-         "function", "return", "echo"
-         // Add keywords if needed
-    };
+// 0 for ( ), 1 for [ ], 2 for { }
+static int bracketKind(char ch) {
+    if (ch == '(' || ch == ')') {
+        return 0;
+    }
+    return (ch == '[' || ch == ']') ? 1 : 2;
+}
+
+void BracketMatcher::onToken(const TokenView& token) {
+    LEXER_ALLOCATION_SCOPE("BracketMatcher");
+
+    size_t tokenIndex = index.matches.size();
+    index.matches.push_back(BracketIndex::NO_MATCH);
+
+    switch (token.subtype) {
+        case TokenSubtype::PUNCTUATION_LEFT_PARENTHESIS:
+        case TokenSubtype::PUNCTUATION_LEFT_BRACKET:
+        case TokenSubtype::PUNCTUATION_LEFT_BRACE: {
+            char ch = token.value[0];
+            index.openBrackets.push_back(BracketIndex::OpenBracket{tokenIndex, ch});
+            index.openCounts[bracketKind(ch)]++;
+            break;
+        }
+        case TokenSubtype::PUNCTUATION_RIGHT_PARENTHESIS:
+        case TokenSubtype::PUNCTUATION_RIGHT_BRACKET:
+        case TokenSubtype::PUNCTUATION_RIGHT_BRACE: {
+            int kind = bracketKind(token.value[0]);
+
+            if (index.openCounts[kind] == 0) {
+                // Nothing to close, checked by the counter to not scan the stack
+                index.unbalanced.push_back(tokenIndex);
+            } else {
+                // Brackets opened after the matching one are never closed
+                while (bracketKind(index.openBrackets.back().bracket) != kind) {
+                    index.unbalanced.push_back(index.openBrackets.back().tokenIndex);
+                    index.openCounts[bracketKind(index.openBrackets.back().bracket)]--;
+                    index.openBrackets.pop_back();
+                }
+                size_t openingIndex = index.openBrackets.back().tokenIndex;
+                index.openBrackets.pop_back();
+                index.openCounts[kind]--;
+                index.matches[openingIndex] = tokenIndex;
+                index.matches[tokenIndex] = openingIndex;
+            }
+            break;
+        }
+        default:
+            if (token.type == TokenType::END_OF_FILE) {
+                // Brackets left open
+                for (const auto& openBracket : index.openBrackets) {
+                    index.unbalanced.push_back(openBracket.tokenIndex);
+                }
+                std::sort(index.unbalanced.begin(), index.unbalanced.end());
+                index.openBrackets.clear();
+            }
+    }
 
-    // List of operators written as keywords
-    std::string keywordOperators[3] = {
-        "and", "or", "xor"
-    };
+    next.onToken(token);
+}
 
-    // Operators (except the ones written as keywords)
-    // Source: https://www.w3schools.com/php/php_operators.asp
-    std::string operators[33] = {
-        "+", "-", "*", "/", "%", // Arithmetic operators
-        "=", "+=", "-=", "*=", "/=", "%=", // Assignment operators
-        "==", "===" "!=", "!==", "<", ">", "<=", ">=", "<=>", // Comparison operators
-        "<>" // Not equals for arrays
-        "&&", "||", "!", // Logical operators
-        "&", "|", "^", "~", "<<", ">>", // Bitwise operators
-        ".=", ".", // String operators
-        "?", ":", "??" // Conditional operators
-    };
+bool PHPLexer::isLetter(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+}
 
-public:
+bool PHPLexer::isDigit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
 
-    // Sets the input sourceCode
-    void setSourceCode(std::string code) {
-                
-        sourceCode = code;
-        curPos = 0;
-        line = 1;
-        sourceCodelength = code.length();
-    };
+bool PHPLexer::isNameStart(char ch) {
+    return isLetter(ch) || ch == '_' || static_cast<unsigned char>(ch) >= 0x80;
+}
 
-    // If the lexer should print messages to the console
-    void setTrace(bool t) {
-        trace = t;
-    }
+bool PHPLexer::isNameChar(char ch) {
+    return isNameStart(ch) || isDigit(ch);
+}
+
+void PHPLexer::setSourceCode(const std::string& code) {
+    LEXER_ALLOCATION_SCOPE("setSourceCode");
     
-    // Retrieving tokens from the sourceCode
-    // Should be called after invoking setSourceCode() method
-    // Returns a list of Toknes always ending with END_OF_FILE token
-    // May throw LexerExcetion
-    std::list<Token> getTokens() {
-        std::list<Token> tokens;
+    ownedSourceCode.assign(code); // Reuses the capacity left from the previous code
+    setSourceView(ownedSourceCode);
+}
 
-        while (curPos < sourceCodelength) {
+void PHPLexer::setSourceView(std::string_view code) {
 
-            char ch = sourceCode[curPos];
+    sourceCode = code;
+    curPos = 0;
+    line = 1;
+    sourceCodelength = code.length();
+}
 
-            if (ch == '\n') {
-                line++;
-            }
+std::list<Token> PHPLexer::getTokens() {
+    LEXER_ALLOCATION_SCOPE("getTokens_list");
 
-            // Methods named like extract... return approriate token or through a
-            // LexerException error. If token was found, such methods always
-            // leave curPos pointing on the last symbol of the lexeme
+    getTokens(tokenViews);
 
-            // Methods named like isAbleToExtract... try to extract an appropriate token:
-            // If token was found, then add it in the tokens list, sets curPos on the
-            //     last symbol of the token and return true. No other routes are checked
-            // Otherwise just resests curPos to the position before method was called
-            //     and return false, so other routes are checked
+    std::list<Token> tokens;
+    for (const auto& view : tokenViews) {
+        tokens.push_back(Token(view.type, std::string(view.value), view.subtype));
+    }
+    return tokens;
+}
+
+void PHPLexer::getTokens(std::vector<TokenView>& tokens) {
+    tokens.clear();
+    VectorTokenSink sink(tokens);
+    getTokens(sink);
+}
+
+void PHPLexer::getTokens(std::vector<TokenView>& tokens, BracketIndex& brackets) {
+    tokens.clear();
+    brackets.clear();
+    VectorTokenSink sink(tokens);
+    BracketMatcher matcher(sink, brackets);
+    getTokens(matcher);
+}
+
+void PHPLexer::getTokens(TokenSink& tokens) {
+    LEXER_ALLOCATION_SCOPE("getTokens_sink");
+
+    invalidUtf8Offsets.clear();
+    if (utf8Validation) {
+        validateUtf8(sourceCode.substr(curPos), invalidUtf8Offsets);
+        for (size_t& offset : invalidUtf8Offsets) {
+            offset += curPos;
+        }
+    }
 
-            // The demand of leave curPos on the last symbol is important to
-            // continue processing next tokens after this cycle's curPos++ is executed.
+    // UTF-8 byte order mark isn't a part of the code
+    if (curPos == 0 && sourceCode.substr(0, 3) == "\xEF\xBB\xBF") {
+        curPos = 3;
+    }
 
-            // !!! The order of routes is important
-            
-            // --- Routes ---
-            if (ch == '$') {
-                tokens.push_back(extractIdenetifier());
-            }
-            else if ( (ch == '/' || ch == '#') && isAbleToExtractComment(tokens)) {  /* Check the doc string on isAbleToExtractComment*/ }
-            else if (isAbleToExtractPunctuation(tokens)) { /* Check the doc string on isAbleToExtractPunctuation method*/ }
-            else if (isAbleToExtractBoolean(tokens)) { /* Check the doc string on isAbleToExtractBoolean method*/ }
-            else if (isalpha(ch) || ch == '_') {
-                tokens.push_back(extractKeyword_KeywordOperator_Null());
-            }
-            else if (ch == '"' || ch == '\'') {
-                tokens.push_back(extractString());
-            } 
-            else if (isdigit(ch)) {
-                tokens.push_back(extractIntegerOrFloat());
-            } 
-            else if (isOperatorSymbol(ch)) {
-                tokens.push_back(extractOperator());
-            }
-        
+    while (curPos < sourceCodelength) {
+
+        char ch = sourceCode[curPos];
+
+        if (ch == '\n') {
+            line++;
+        }
+
+        // Whitespace never starts a token, so the routes aren't tried on it
+        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
             curPos++;
+            continue;
         }
 
-        tokens.push_back(Token(TokenType::END_OF_FILE, ""));
-        
-        return tokens;
-    }
+        // Methods named like extract... return approriate token or through a
+        // LexerException error. If token was found, such methods always
+        // leave curPos pointing on the last symbol of the lexeme
 
-    // Helping method to raise error.
-    // Takes the beggining and the end of the words, find "broken" spot and
-    // puts it in the thrown LexerException.
-    // If curPos is on the whitespace, then takes two near words
-    void raiseError(std::string message, int pos) {
+        // Methods named like isAbleToExtract... try to extract an appropriate token:
+        // If token was found, then add it in the tokens list, sets curPos on the
+        //     last symbol of the token and return true. No other routes are checked
+        // Otherwise just resests curPos to the position before method was called
+        //     and return false, so other routes are checked
 
-        int wordStartPos = pos;
-        int wordEndPos = pos;
+        // The demand of leave curPos on the last symbol is important to
+        // continue processing next tokens after this cycle's curPos++ is executed.
 
-        // Looking for start and end of the word
-        if (pos > 0) {
-            wordStartPos--;
-        }
-        if (pos < sourceCodelength-1) {
-            wordEndPos++;
+        // !!! The order of routes is important
+        
+        // --- Routes ---
+        if (ch == '$') {
+            tokens.onToken(extractIdenetifier());
         }
-        while (wordStartPos > 0 && sourceCode[wordStartPos] != ' ') {
-            wordStartPos--;
+        else if ( (ch == '/' || ch == '#') && isAbleToExtractComment(tokens)) {  /* Check the doc string on isAbleToExtractComment*/ }
+        else if (isAbleToExtractPunctuation(tokens)) { /* Check the doc string on isAbleToExtractPunctuation method*/ }
+        else if (isAbleToExtractBoolean(tokens)) { /* Check the doc string on isAbleToExtractBoolean method*/ }
+        else if (isNameStart(ch)) {
+            tokens.onToken(extractKeyword_KeywordOperator_Null());
         }
-        while (wordEndPos < sourceCodelength && sourceCode[wordEndPos] != ' ') {
-            wordEndPos++;
+        else if (ch == '"' || ch == '\'') {
+            tokens.onToken(extractString());
+        } 
+        else if (isDigit(ch)) {
+            tokens.onToken(extractIntegerOrFloat());
+        } 
+        else if (isOperatorSymbol(ch)) {
+            tokens.onToken(extractOperator());
         }
+    
+        curPos++;
+    }
 
-        // Showing the position
-        std::string positionStr = " at position: " + std::to_string(pos);
+    // Empty view pointing to the end of the code
+    tokens.onToken(TokenView{TokenType::END_OF_FILE, sourceCode.substr(sourceCodelength)});
+}
 
-        // Finidng the trace
-        std::string errorTrace;
-        errorTrace += sourceCode.substr(wordStartPos, pos - wordStartPos);
-        errorTrace += "<---";
-        errorTrace += sourceCode.substr(pos, wordEndPos - pos);
+void PHPLexer::raiseError(std::string message, int pos) {
+    LEXER_ALLOCATION_SCOPE("raiseError");
 
-        // Getting everything up
-        message += positionStr;
-        message += ": " + errorTrace;
+    // The word around the position is shown, but not more than this number of characters on each side,
+    // otherwise a megabyte-long word would be scanned and copied into the message
+    const int MAX_TRACE_CHARS = 32;
 
-        throw LexerException(message);
+    int wordStartPos = pos;
+    int wordEndPos = pos;
+    int minWordStartPos = std::max(0, pos - MAX_TRACE_CHARS);
+    int maxWordEndPos = static_cast<int>(std::min<size_t>(sourceCodelength, pos + MAX_TRACE_CHARS));
+
+    // Looking for start and end of the word
+    if (pos > 0) {
+        wordStartPos--;
+    }
+    if (static_cast<size_t>(pos) + 1 < sourceCodelength) {
+        wordEndPos++;
+    }
+    while (wordStartPos > minWordStartPos && sourceCode[wordStartPos] != ' ') {
+        wordStartPos--;
+    }
+    while (wordEndPos < maxWordEndPos && sourceCode[wordEndPos] != ' ') {
+        wordEndPos++;
     }
 
+    // Showing the position
+    std::string positionStr = " at position: " + std::to_string(pos);
 
-    // Extracts an indentifier from the current position.
-    // Uses Finite Automata to recognize identifiers.
-    Token extractIdenetifier() {
+    // Finidng the trace
+    std::string errorTrace;
+    errorTrace += sourceCode.substr(wordStartPos, pos - wordStartPos);
+    errorTrace += "<---";
+    errorTrace += sourceCode.substr(pos, wordEndPos - pos);
 
-        if (trace) {
-            std::cout << "Extracting identifier at position: " << curPos << std::endl;
-        }
+    // Getting everything up
+    message += positionStr;
+    message += ": " + errorTrace;
 
-        enum STATE {
-            START,
-            IDENTIFIER_FIRST, // Checing if the first character is valid for an identifier
-            IDENTIFIER,
-            ACCEPT
-        } state = START;
-        
-        std::string identifier;
+    throw LexerException(message);
+}
 
-        while (curPos < sourceCodelength && state != ACCEPT) {
+TokenView PHPLexer::extractIdenetifier() {
+    LEXER_ALLOCATION_SCOPE("extractIdenetifier");
 
-            char ch = sourceCode[curPos];
+    if (trace) {
+        std::cout << "Extracting identifier at position: " << curPos << std::endl;
+    }
 
-            switch (state)
-            {
-            case START:
-                if (ch == '$') {
-                    identifier += ch;
-                    state = IDENTIFIER_FIRST;
-                } else {
-                    // Should never be reached if the method is called properly
-                    raiseError("Expected '$' at the start of identifier", curPos);
-                }
-                break;
-            
-            case IDENTIFIER_FIRST:
-                if (isalpha(ch) || ch == '_') {
-                    identifier += ch;
-                    state = IDENTIFIER;
-                } else {
-                    // Handle an unexpected character
-                    raiseError("Invalid first character in identifier: ", curPos);
-                }
-                break;
+    enum STATE {
+        START,
+        IDENTIFIER_FIRST, // Checing if the first character is valid for an identifier
+        IDENTIFIER,
+        ACCEPT
+    } state = START;
+    
+    size_t startPos = curPos;
 
-            case IDENTIFIER:
-                if (isalnum(ch) || ch == '_') {
-                    identifier += ch;
-                } else {
-                    state = ACCEPT;
-                    curPos--; // Making curPos to point to the last symbol of the token
-                }
-                break;
+    while (curPos < sourceCodelength && state != ACCEPT) {
 
-            
-            }  
-        curPos++;    
-         
-        }
+        char ch = sourceCode[curPos];
+
+        switch (state)
+        {
+        case START:
+            if (ch == '$') {
+                state = IDENTIFIER_FIRST;
+            } else {
+                // Should never be reached if the method is called properly
+                raiseError("Expected '$' at the start of identifier", curPos);
+            }
+            break;
+        
+        case IDENTIFIER_FIRST:
+            if (isNameStart(ch)) {
+                state = IDENTIFIER;
+            } else {
+                // Handle an unexpected character
+                raiseError("Invalid first character in identifier: ", curPos);
+            }
+            break;
 
-        curPos--; // Compensate the last cycle curPos++ execution
-        Token token(TokenType::IDENTIFIER, identifier);
-        return token; 
+        case IDENTIFIER:
+            if (!isNameChar(ch)) {
+                state = ACCEPT;
+                curPos--; // Making curPos to point to the last symbol of the token
+            }
+            break;
+
+        default: // ACCEPT ends the loop
+            break;
+        }  
+    curPos++;    
+     
     }
 
-    // Extracts a keyword, a keyword operators ('and', 'or', 'xor') or 'NULL' from the currect position
-    // Uses almost Finite Automata to recognize keywords
-    Token extractKeyword_KeywordOperator_Null() {
+    curPos--; // Compensate the last cycle curPos++ execution
+    return TokenView{TokenType::IDENTIFIER, sourceCode.substr(startPos, curPos + 1 - startPos)};
+}
 
-        if (trace) {
-            std::cout << "Extracting keyword at position: " << curPos << std::endl;
-        }
+TokenView PHPLexer::extractKeyword_KeywordOperator_Null() {
+    LEXER_ALLOCATION_SCOPE("extractKeyword_KeywordOperator_Null");
 
-        enum STATE {
-            START,
-            KEYWORD,
-            END
-        } state = START;
+    if (trace) {
+        std::cout << "Extracting keyword at position: " << curPos << std::endl;
+    }
 
-        std::string potentialKeyword;
+    enum STATE {
+        START,
+        KEYWORD,
+        END
+    } state = START;
 
-        while (curPos < sourceCodelength && state != END) {
-            char ch = sourceCode[curPos];
+    size_t startPos = curPos;
 
-            switch (state)
-            {
-            case START:
-                if (isalpha(ch) || ch == '_') {
-                    potentialKeyword += ch;
-                    state = KEYWORD;
-                } else {
-                    raiseError("Expected a letter or underscore at the start of keyword", curPos);
-                }
-                break;
+    while (curPos < sourceCodelength && state != END) {
+        char ch = sourceCode[curPos];
 
-            case KEYWORD:
-                if (isalnum(ch) || ch == '_') {
-                    potentialKeyword += ch;
-                } else {
-                    curPos--; // Making curPos to point to the last symbol of the token
-                    state = END;
-                }
-                break;
+        switch (state)
+        {
+        case START:
+            if (isNameStart(ch)) {
+                state = KEYWORD;
+            } else {
+                raiseError("Expected a letter or underscore at the start of keyword", curPos);
             }
-            curPos++;
-        }
-
-        curPos--; // Compensating last cycle curPos++ execution
+            break;
 
-        // Checking for keywords
-        for(std::string keyword: keywords) {
-            if (potentialKeyword == keyword) {
-                return Token(TokenType::KEYWORD, potentialKeyword);
+        case KEYWORD:
+            if (!isNameChar(ch)) {
+                curPos--; // Making curPos to point to the last symbol of the token
+                state = END;
             }
+            break;
+
+        default: // END ends the loop
+            break;
         }
+        curPos++;
+    }
 
-        // Checking for operators written as keywords (e.g and, or, xor)
-        for(std::string keywordOperator: keywordOperators) {
-            if (potentialKeyword == keywordOperator) {
-                return Token(TokenType::OPERATOR, potentialKeyword);
-            }
+    curPos--; // Compensating last cycle curPos++ execution
+    std::string_view potentialKeyword = sourceCode.substr(startPos, curPos + 1 - startPos);
+
+    static_assert(sizeof(keywords) / sizeof(keywords[0]) == std::size(keywordSubtypes), "Every keyword must have a subtype");
+    static_assert(sizeof(keywordOperators) / sizeof(keywordOperators[0]) == std::size(keywordOperatorSubtypes),
+        "Every keyword operator must have a subtype");
+
+    // Checking for keywords
+    for (size_t i = 0; i < std::size(keywords); i++) {
+        if (potentialKeyword == keywords[i]) {
+            return TokenView{TokenType::KEYWORD, potentialKeyword, keywordSubtypes[i]};
         }
+    }
 
-        // Checking for null
-        if (potentialKeyword == "NULL") {
-            return Token(TokenType::NUL, potentialKeyword);
+    // Checking for operators written as keywords (e.g and, or, xor)
+    for (size_t i = 0; i < std::size(keywordOperators); i++) {
+        if (potentialKeyword == keywordOperators[i]) {
+            return TokenView{TokenType::OPERATOR, potentialKeyword, keywordOperatorSubtypes[i]};
         }
-        
-        raiseError("Unrecognized keyword: ", curPos);
     }
 
-    // Extracts a string from the current position
-    // Uses (alomst) Finite Automata to recognize strings:
-    // has quotChar memory slot to keep it simple
-    Token extractString() {
+    // Checking for null
+    if (potentialKeyword == "NULL") {
+        return TokenView{TokenType::NUL, potentialKeyword, TokenSubtype::NUL};
+    }
+    
+    raiseError("Unrecognized keyword: ", curPos);
+}
+
+TokenView PHPLexer::extractString() {
+    LEXER_ALLOCATION_SCOPE("extractString");
+
+    if (trace) {
+        std::cout << "Extracting string at position: " << curPos << std::endl;
+    }
+
+    enum STATE {
+        START,
+        STRING_CONTENT,
+        END
+    } state = START;
+
+    // Value of the string includes quotes
+    size_t startPos = curPos;
+
+    char quoteChar = '\0'; 
+
+    while (curPos < sourceCodelength && state != END) {
+        char ch = sourceCode[curPos];
+
+        switch (state)
+        {
+        case START:
+            if (ch == '"') {
+                quoteChar = '"';
+            } else if (ch == '\'') {
+                quoteChar = '\'';
+            } else {
+                // Would never be reached if the method is called properly
+                raiseError("Expected a quote character to start string", curPos);
+            }
 
-        if (trace) {
-            std::cout << "Extracting string at position: " << curPos << std::endl;
+            state = STRING_CONTENT;
+            break;
+        
+        case STRING_CONTENT:
+            if (ch == quoteChar) { // Used non-FA trick to avoid doubling states
+                state = END;
+            } else if (curPos == sourceCodelength-1 || ch == '\n') {
+                raiseError("Unterminated string literal", curPos);
+            }
+            // ch is a part of the value no matter it's the content or an ending quote
+            break;
+
+        default: // END ends the loop
+            break;
         }
 
-        enum STATE {
-            START,
-            STRING_CONTENT,
-            END
-        } state = START;
+        curPos++;
+    }
 
-        // Value of the string including quotes
-        std::string strValue;
+    curPos--; // Compensating the last cycle's curPos++ execution
 
-        char quoteChar = '\0'; 
+    return TokenView{TokenType::STRING, sourceCode.substr(startPos, curPos + 1 - startPos)};
+}
 
-        while (curPos < sourceCodelength && state != END) {
-            char ch = sourceCode[curPos];
+TokenView PHPLexer::extractIntegerOrFloat() {
+    LEXER_ALLOCATION_SCOPE("extractIntegerOrFloat");
 
-            switch (state)
-            {
-            case START:
-                if (ch == '"') {
-                    quoteChar = '"';
-                } else if (ch == '\'') {
-                    quoteChar = '\'';
-                } else {
-                    // Would never be reached if the method is called properly
-                    raiseError("Expected a quote character to start string", curPos);
-                }
+    if (trace) {
+        std::cout << "Extracting number at position: " << curPos << std::endl;
+    }
 
-                strValue += ch;
-                state = STRING_CONTENT;
-                break;
-            
-            case STRING_CONTENT:
-                if (ch == quoteChar) { // Used non-FA trick to avoid doubling states
-                    state = END;
-                } else if (curPos == sourceCodelength-1 || ch == '\n') {
-                    raiseError("Unterminated string literal", curPos);
-                }
-                
-                // Adding ch no matter it's part of the content or an ending quote
-                strValue += ch;
+    enum STATE {
+        START,
+        LEADING_ZERO, // Has leadng zero e.g. 01 or 0.1
+        INTEGER_PART, // Haven't meet a point yet (may result in Integer or Float)
+        FLOAT, // Met a point
+        ACCEPT_INTEGER,
+        ACCEPT_FLOAT
+    } state = START;
+
+    size_t startPos = curPos;
+
+    while (curPos < sourceCodelength && state != ACCEPT_INTEGER && state != ACCEPT_FLOAT) {
+        char ch = sourceCode[curPos];
+
+        switch (state)
+        {
+        case START:
+            if (ch == '0')  {
+                state = LEADING_ZERO;
+            } else if (isDigit(ch)) {
+                state = INTEGER_PART;
+            } else {
+                // Never reached if the method is called properly
+                raiseError("Expected a digit at the start of number", curPos);
+            }
+            break;
+        
+        case LEADING_ZERO:
+            if (ch == '.') {
+                state = FLOAT;
+            } else if (!isDigit(ch)) { // Just a zero integer case
+                state = ACCEPT_INTEGER;
+                curPos--; // Leave curPos on the end of the token
+            } else {
+                raiseError("Leading zero must be followed by a decimal point", curPos);
+            }
+            break;
+        
+        case INTEGER_PART:
+            if (ch == '.') {
+                state = FLOAT;
+            } else if (!isDigit(ch)) {
+                state = ACCEPT_INTEGER;
+                curPos--; // Leave curPos on the end of the token
             }
 
-            curPos++;
+            break;
+        
+        case FLOAT:
+            if (!isDigit(ch)) {
+                state = ACCEPT_FLOAT;
+                curPos--; // Leave curPos on the end of the token
+            }
+            break;
+
+        default: // ACCEPT_INTEGER and ACCEPT_FLOAT end the loop
+            break;
         }
+    
+        curPos++;
+    }
 
-        curPos--; // Compensating the last cycle's curPos++ execution
+    curPos--; // Compensate the while's last curPos++ execution
+    std::string_view value = sourceCode.substr(startPos, curPos + 1 - startPos);
 
-        return Token(TokenType::STRING, strValue);
+    // ACCEPT_FLOAT is needed ending of the file
+    if (state == ACCEPT_FLOAT || state == FLOAT) {
+        return TokenView{TokenType::FLOAT, value};
+    }
+    // If some other state like INTEGER_PART, ACCEPT_INTEGER or LEADING_ZERO
+    else {
+        return TokenView{TokenType::INTEGER, value};
     }
+}
 
-    // Extracts a number (integer or float) from the current position
-    // Uses Finite Automata
-    Token extractIntegerOrFloat() {
+bool PHPLexer::isAbleToExtractBoolean(TokenSink& tokens) {
+    LEXER_ALLOCATION_SCOPE("isAbleToExtractBoolean");
 
-        if (trace) {
-            std::cout << "Extracting number at position: " << curPos << std::endl;
+    if (trace) {
+        std::cout << "Checking for boolean at position: " << curPos << std::endl;
+    }
+
+    size_t startPos = curPos;
+
+    // The word (run of name characters, as for identifiers) must be exactly true or false. Only the characters
+    // up to the length of false are looked at, a long word is then scanned once by the keyword extractor
+    for (TokenSubtype subtype : {TokenSubtype::BOOLEAN_TRUE, TokenSubtype::BOOLEAN_FALSE}) {
+        std::string_view value = tokenSubtypeSpelling(subtype);
+        size_t endPos = startPos + value.length();
+        if (sourceCode.substr(startPos, value.length()) == value
+            && (endPos == sourceCodelength || !isNameChar(sourceCode[endPos]))) {
+            curPos = endPos - 1; // Leave curPos on the last symbol of the token
+            tokens.onToken(TokenView{TokenType::BOOLEAN, sourceCode.substr(startPos, value.length()), subtype});
+            return true;
         }
+    }
 
-        enum STATE {
-            START,
-            LEADING_ZERO, // Has leadng zero e.g. 01 or 0.1
-            INTEGER_PART, // Haven't meet a point yet (may result in Integer or Float)
-            FLOAT, // Met a point
-            ACCEPT_INTEGER,
-            ACCEPT_FLOAT
-        } state = START;
+    // No boolean value found 
+    return false;       
+}
 
-        std::string value;
+bool PHPLexer::isOperatorSymbol(char ch) {
+    // string_view to avoid building a string on every call
+    constexpr std::string_view operatorSymbols = "+-*/%=&|^~<>!?:.@";
 
-        while (curPos < sourceCodelength && state != ACCEPT_INTEGER && state != ACCEPT_FLOAT) {
-            char ch = sourceCode[curPos];
+    return operatorSymbols.find(ch) != std::string_view::npos;
+}
 
-            switch (state)
-            {
+TokenView PHPLexer::extractOperator() {
+    LEXER_ALLOCATION_SCOPE("extractOperator");
+    
+    // I think this method can be implemented 5 times shorter withou using Finite Automata,
+    // but let it be :D, trying to do accroding to the lab rules where possible
+
+    if (trace) {
+        std::cout << "Extracting operator at position: " << curPos << std::endl;
+    }
+
+    enum STATE {
+        START,
+
+        // --- Starting states ---
+        // Choosing automata path depending on the first character
+        ARYTHMETIC_FIRST, // Also includes string operator ., becouse it is handeled like arythmetic operators
+        LESS_FIRST,
+        GREATER_FIRST,
+        ASSIGNMENT_FIRST,
+        NOT_FIRST,
+        LOGICAL, // For |, ||, &, &&
+        QESTION_MARK,
+
+        // On one-element operators without possible continuation goes to ACCEPT
+
+        // --- Processing states ---
+        LESS_EQUAL, // After COMPARISON_FIRST, may result in <= or <=>
+        DOUBLE_EQUAL, // After ASSIGNMENT_FIRST
+        NOT_EQUAL,
+    
+        ACCEPT
+    } state = START;
+
+    size_t startPos = curPos;
+    char ch;
+    // Set on entering a state to the operator accepted in it, so it's right whenever the automaton stops
+    TokenSubtype subtype = TokenSubtype::NONE;
+
+    while(curPos < sourceCodelength && state != ACCEPT) {
+        ch = sourceCode[curPos];
+
+        switch (state)
+        {
             case START:
-                if (ch == '0')  {
-                    state = LEADING_ZERO;
-                } else if (isdigit(ch)) {
-                    state = INTEGER_PART;
+                if (ch == '+' || ch == '-' || ch == '*' || ch == '/' || ch == '%' || ch == '.') {
+                    state = ARYTHMETIC_FIRST;
+                    // Subtypes are in the order of "+-*/%."
+                    subtype = addToSubtype(TokenSubtype::OPERATOR_PLUS, std::string_view("+-*/%.").find(ch));
+                }
+                else if (ch == '<') {
+                    state = LESS_FIRST;
+                    subtype = TokenSubtype::OPERATOR_LESS;
+                }
+                else if (ch == '>') {
+                    state = GREATER_FIRST;
+                    subtype = TokenSubtype::OPERATOR_GREATER;
+                }
+                else if (ch == '=') {
+                    state = ASSIGNMENT_FIRST;
+                    subtype = TokenSubtype::OPERATOR_ASSIGN;
+                }
+                else if (ch == '!') {
+                    state = NOT_FIRST;
+                    subtype = TokenSubtype::OPERATOR_NOT;
+                }
+                else if (ch == '&' || ch == '|') { // Excepts ~ and ^
+                    state = LOGICAL;
+                    subtype = ch == '&' ? TokenSubtype::OPERATOR_BITWISE_AND : TokenSubtype::OPERATOR_BITWISE_OR;
+                }
+                // Single character operators
+                else if (ch == ':' || ch == '~' || ch == '^' || ch == '@') {
+                    state = ACCEPT;
+                    // Subtypes are in the order of "^~:@"
+                    subtype = addToSubtype(TokenSubtype::OPERATOR_BITWISE_XOR, std::string_view("^~:@").find(ch));
+                }
+                else if (ch == '?') {
+                    state = QESTION_MARK;
+                    subtype = TokenSubtype::OPERATOR_QUESTION;
+                }
+                else {
+                    // Would never be reached, if I didn't mess up in the state-transmission above and if method is called properly
+                    raiseError("Unexpected start character for operator: ", curPos);
+                }
+                break;
+
+            case ARYTHMETIC_FIRST:
+                if (!isOperatorSymbol(ch)) {
+                    state = ACCEPT;
+                    curPos--;
+                } else if (ch == '=') {
+                    state = ACCEPT;
+                    // Assignments follow the arithmetic operators in the same order
+                    subtype = addToSubtype(subtype, 6);
                 } else {
-                    // Never reached if the method is called properly
-                    raiseError("Expected a digit at the start of number", curPos);
+                    raiseError("Unexpected character in arithmetic operator: ", curPos);
                 }
-                value += ch;
                 break;
-            
-            case LEADING_ZERO:
-                if (ch == '.') {
-                    state = FLOAT;
-                    value += ch;
-                } else if (!isdigit(ch)) { // Just a zero integer case
-                    state = ACCEPT_INTEGER;
-                    curPos--; // Leave curPos on the end of the token
+
+            case LESS_FIRST:
+                if (!isOperatorSymbol(ch)) { // Just <
+                    curPos--; // Step back to reprocess the current character
+                    state = ACCEPT;
+                } 
+                else if (ch == '=') { // <=
+                    state = LESS_EQUAL;
+                    subtype = TokenSubtype::OPERATOR_LESS_EQUAL;
+                }
+                else if (ch == '<' || ch == '>') { // << or <>
+                    state = ACCEPT;
+                    subtype = ch == '<' ? TokenSubtype::OPERATOR_SHIFT_LEFT : TokenSubtype::OPERATOR_ARRAY_NOT_EQUAL;
                 } else {
-                    raiseError("Leading zero must be followed by a decimal point", curPos);
+                    raiseError("Unexpected character in less operator: ", curPos);
                 }
                 break;
-            
-            case INTEGER_PART:
-                if (ch == '.') {
-                    state = FLOAT;
-                    value += ch;
-                } else if (!isdigit(ch)) {
-                    state = ACCEPT_INTEGER;
-                    curPos--; // Leave curPos on the end of the token
+            case LESS_EQUAL:
+                if (ch == '>') { // <=>
+                    state = ACCEPT; 
+                    subtype = TokenSubtype::OPERATOR_SPACESHIP;
+                } else if (!isOperatorSymbol(ch)) { // <=
+                    state = ACCEPT;
+                    curPos--;
+                } else {
+                    raiseError("Unexpected character in less equal operator: ", curPos);
+                }
+                break;
+
+            case GREATER_FIRST:
+                if (!isOperatorSymbol(ch)) { // Just >
+                    state = ACCEPT;
+                    curPos--; // Step back to reprocess the current character
+                } else if (ch == '=' || ch == '>') { // >= or >>
+                    state = ACCEPT;
+                    subtype = ch == '=' ? TokenSubtype::OPERATOR_GREATER_EQUAL : TokenSubtype::OPERATOR_SHIFT_RIGHT;
                 } else {
-                    value += ch;
+                    raiseError("Unexpected character in greater operator: ", curPos);
                 }
+                break;
 
+            case ASSIGNMENT_FIRST:
+                if (ch == '=') {
+                    state = DOUBLE_EQUAL; // Could be a comparison operator
+                    subtype = TokenSubtype::OPERATOR_EQUAL;
+                } else if (!isOperatorSymbol(ch)) {
+                    state = ACCEPT;
+                    curPos--; // Step back to reprocess the current character
+                } else {
+                    raiseError("Unexpected character in assignment operator: ", curPos);
+                }
+                break; 
+            case DOUBLE_EQUAL:
+                if (ch == '=') { // === met
+                    state = ACCEPT; 
+                    subtype = TokenSubtype::OPERATOR_IDENTICAL;
+                } else if (!isOperatorSymbol(ch)) { // == 
+                    curPos--; // Step back to reprocess the current character
+                    state = ACCEPT;
+                } else {
+                    raiseError("Unexpected character in double equal operator: ", curPos);
+                }
                 break;
-            
-            case FLOAT:
-                if (isdigit(ch)) {
-                    value += ch;
+
+            case NOT_FIRST:
+                if (ch == '=') {
+                    state = NOT_EQUAL;
+                    subtype = TokenSubtype::OPERATOR_NOT_EQUAL;
+                } else if (!isOperatorSymbol(ch)) { // Just ! 
+                    state = ACCEPT;
+                    curPos--; // Step back to reprocess the current character
                 } else {
-                    state = ACCEPT_FLOAT;
-                    curPos--; // Leave curPos on the end of the token
+                    raiseError("Unexpected character in not operator: ", curPos);
+                }
+                break;
+            case NOT_EQUAL:
+                if (ch == '=') { // !== met
+                    state = ACCEPT; 
+                    subtype = TokenSubtype::OPERATOR_NOT_IDENTICAL;
+                } else if (!isOperatorSymbol(ch)) { // !=
+                    state = ACCEPT;
+                    curPos--; // Step back to reprocess the current character
+                } else {
+                    raiseError("Unexpected character in not equal operator: ", curPos);
                 }
                 break;
-            }
-        
-            curPos++;
-        }
 
-        curPos--; // Compensate the while's last curPos++ execution
+            case LOGICAL:
+                if (!isOperatorSymbol(ch)) { // Bitwise | or &
+                    state = ACCEPT;
+                    curPos--; // Step back to reprocess the current character
+                } else if (ch == sourceCode[startPos]) { // && or ||, used non-FA techique to avoid doubling state
+                    state = ACCEPT; 
+                    subtype = ch == '&' ? TokenSubtype::OPERATOR_LOGICAL_AND : TokenSubtype::OPERATOR_LOGICAL_OR;
+                } else {
+                    raiseError("Unexpected character in logical operator: ", curPos);
+                } 
+                break;
 
-        // ACCEPT_FLOAT is needed ending of the file
-        if (state == ACCEPT_FLOAT || state == FLOAT) {
-            return Token(TokenType::FLOAT, value);
-        }
-        // If some other state like INTEGER_PART, ACCEPT_INTEGER or LEADING_ZERO
-        else {
-            return Token(TokenType::INTEGER, value);
-        }
-    }
+            case QESTION_MARK:
+                if (!isOperatorSymbol(ch)) {
+                    state = ACCEPT; // Just ?
+                    curPos--; // Step back to reprocess the current character
+                } else if (ch == '?') { // ?? met
+                    state = ACCEPT; 
+                    subtype = TokenSubtype::OPERATOR_NULL_COALESCING;
+                } else {
+                    raiseError("Unexpected character in question mark operator: ", curPos);
+                }
 
-    // Working with booleans:
-    // 1. Tries to extract a boolean value
-    // 2. If a boolean value is found, adds approriate token to the list
-    // 3. Returns true if a boolean value was found, false otherwise
-    bool isAbleToExtractBoolean(std::list<Token>& tokens) {
+                break;
 
-        if (trace) {
-            std::cout << "Checking for boolean at position: " << curPos << std::endl;
+            default: // ACCEPT ends the loop
+                break;
         }
 
-        size_t startPos = curPos;
-        std::string value;
-
-        char ch;
+        curPos++;
+    }
 
-        while (curPos < sourceCodelength) {
-            ch = sourceCode[curPos];
+    curPos--; // Compensate the while's last curPos++ execution
+    return TokenView{TokenType::OPERATOR, sourceCode.substr(startPos, curPos + 1 - startPos), subtype};
+}
 
-            if (!isalpha(ch)) {
-                break; // Stop if we hit a non-alphabetic character
-            }
+bool PHPLexer::isPunctuationSymbol(char ch) {
 
-            value += ch; 
-            curPos++;
-        }
+    const char punctuationSymbols[15] = {
+        ';', ',', '.',
+        ':',
+        '=', '?', '-', '>', '.',
+        '[', ']', '{', '}', '(', ')'
+    };
 
-        if (value == "true" || value == "false") {
-            curPos--; // Compensate the while's last curPos++ execution
-            Token token(TokenType::BOOLEAN, value);
-            tokens.push_back(token);
+    for (char symbol : punctuationSymbols) {
+        if (ch == symbol) {
             return true;
         }
-
-        // No boolean value found 
-        curPos = startPos; // Resetting the position to start 
-        return false;       
     }
+    return false;
+}
 
-    // Checks if the character is an operator symbol like +, =, ? ect
-    bool isOperatorSymbol(char ch) {
-        const std::string operatorSymbols = "+-*/%=&|^~<>!?:.@";
+bool PHPLexer::isAbleToExtractPunctuation(TokenSink& tokens) {
+    LEXER_ALLOCATION_SCOPE("isAbleToExtractPunctuation");
 
-        return operatorSymbols.find(ch) != std::string::npos;
+    if (trace) {
+        std::cout << "Checking for punctuation at position: " << curPos << std::endl;
     }
 
-    // Extracts an operator from the current position
-    // Uses Finite Automata to recognize operators
-    Token extractOperator() {
-        
-        // I think this method can be implemented 5 times shorter withou using Finite Automata,
-        // but let it be :D, trying to do accroding to the lab rules where possible
+    size_t startPos = curPos;
+    bool isPunctuation = true;
+    TokenSubtype subtype = TokenSubtype::NONE;
 
-        if (trace) {
-            std::cout << "Extracting operator at position: " << curPos << std::endl;
-        }
+    char ch = sourceCode[curPos];
 
-        enum STATE {
-            START,
-
-            // --- Starting states ---
-            // Choosing automata path depending on the first character
-            ARYTHMETIC_FIRST, // Also includes string operator ., becouse it is handeled like arythmetic operators
-            LESS_FIRST,
-            GREATER_FIRST,
-            ASSIGNMENT_FIRST,
-            NOT_FIRST,
-            LOGICAL, // For |, ||, &, &&
-            QESTION_MARK,
-
-            // On one-element operators without possible continuation goes to ACCEPT
-
-            // --- Processing states ---
-            LESS_EQUAL, // After COMPARISON_FIRST, may result in <= or <=>
-            DOUBLE_EQUAL, // After ASSIGNMENT_FIRST
-            NOT_EQUAL,
-        
-            ACCEPT
-        } state = START;
-
-        std::string operatorValue;
-        char ch;
-
-        while(curPos < sourceCodelength && state != ACCEPT) {
-            ch = sourceCode[curPos];
-
-            switch (state)
-            {
-                case START:
-                    if (ch == '+' || ch == '-' || ch == '*' || ch == '/' || ch == '%' || ch == '.') {
-                        state = ARYTHMETIC_FIRST;
-                    }
-                    else if (ch == '<') {
-                        state = LESS_FIRST;
-                    }
-                    else if (ch == '>') {
-                        state = GREATER_FIRST;
-                    }
-                    else if (ch == '=') {
-                        state = ASSIGNMENT_FIRST;
-                    }
-                    else if (ch == '!') {
-                        state = NOT_FIRST;
-                    }
-                    else if (ch == '&' || ch == '|') { // Excepts ~ and ^
-                        state = LOGICAL;
-                    }
-                    // Single character operators
-                    else if (ch == ':' || ch == '~' || ch == '^' || ch == '@') {
-                        state = ACCEPT;
-                    }
-                    else if (ch == '?') {
-                        state = QESTION_MARK;
-                    }
-                    else {
-                        // Would never be reached, if I didn't mess up in the state-transmission above and if method is called properly
-                        raiseError("Unexpected start character for operator: ", curPos);
-                    }
-                    operatorValue += ch;
-                    break;
-
-                case ARYTHMETIC_FIRST:
-                    if (!isOperatorSymbol(ch)) {
-                        state = ACCEPT;
-                        curPos--;
-                    } else if (ch == '=') {
-                        state = ACCEPT;
-                        operatorValue += ch;
-                    } else {
-                        raiseError("Unexpected character in arithmetic operator: ", curPos);
-                    }
-                    break;
-
-                case LESS_FIRST:
-                    if (!isOperatorSymbol(ch)) { // Just <
-                        curPos--; // Step back to reprocess the current character
-                        state = ACCEPT;
-                    } 
-                    else if (ch == '=') { 
-                        operatorValue += ch; // <=
-                        state = LESS_EQUAL;
-                    }
-                    else if (ch == '<' || ch == '>') { // << or <>
-                        operatorValue += ch;
-                        state = ACCEPT;
-                    } else {
-                        raiseError("Unexpected character in less operator: ", curPos);
-                    }
-                    break;
-                case LESS_EQUAL:
-                    if (ch == '>') { // <=>
-                        operatorValue += ch;
-                        state = ACCEPT; 
-                    } else if (!isOperatorSymbol(ch)) { // <=
-                        state = ACCEPT;
-                        curPos--;
-                    } else {
-                        raiseError("Unexpected character in less equal operator: ", curPos);
-                    }
-                    break;
-
-                case GREATER_FIRST:
-                    if (!isOperatorSymbol(ch)) { // Just >
-                        state = ACCEPT;
-                        curPos--; // Step back to reprocess the current character
-                    } else if (ch == '=' || ch == '>') { // >= or >>
-                        operatorValue += ch;
-                        state = ACCEPT;
-                    } else {
-                        raiseError("Unexpected character in greater operator: ", curPos);
-                    }
-                    break;
-
-                case ASSIGNMENT_FIRST:
-                    if (ch == '=') {
-                        operatorValue += ch;
-                        state = DOUBLE_EQUAL; // Could be a comparison operator
-                    } else if (!isOperatorSymbol(ch)) {
-                        state = ACCEPT;
-                        curPos--; // Step back to reprocess the current character
-                    } else {
-                        raiseError("Unexpected character in assignment operator: ", curPos);
-                    }
-                    break; 
-                case DOUBLE_EQUAL:
-                    if (ch == '=') { // === met
-                        operatorValue += ch;
-                        state = ACCEPT; 
-                    } else if (!isOperatorSymbol(ch)) { // == 
-                        curPos--; // Step back to reprocess the current character
-                        state = ACCEPT;
-                    } else {
-                        raiseError("Unexpected character in double equal operator: ", curPos);
-                    }
-                    break;
-
-                case NOT_FIRST:
-                    if (ch == '=') {
-                        operatorValue += ch;
-                        state = NOT_EQUAL;
-                    } else if (!isOperatorSymbol(ch)) { // Just ! 
-                        state = ACCEPT;
-                        curPos--; // Step back to reprocess the current character
-                    } else {
-                        raiseError("Unexpected character in not operator: ", curPos);
-                    }
-                    break;
-                case NOT_EQUAL:
-                    if (ch == '=') { // !== met
-                        operatorValue += ch;
-                        state = ACCEPT; 
-                    } else if (!isOperatorSymbol(ch)) { // !=
-                        state = ACCEPT;
-                        curPos--; // Step back to reprocess the current character
-                    } else {
-                        raiseError("Unexpected character in not equal operator: ", curPos);
-                    }
-                    break;
-
-                case LOGICAL:
-                    if (!isOperatorSymbol(ch)) { // Bitwise | or &
-                        state = ACCEPT;
-                        curPos--; // Step back to reprocess the current character
-                    } else if (ch == operatorValue.at(0)) { // Used non-FA techique to avoid doubling state
-                        operatorValue += ch; // && or ||
-                        state = ACCEPT; 
-                    } else {
-                        raiseError("Unexpected character in logical operator: ", curPos);
-                    } 
-                    break;
-
-                case QESTION_MARK:
-                    if (!isOperatorSymbol(ch)) {
-                        state = ACCEPT; // Just ?
-                        curPos--; // Step back to reprocess the current character
-                    } else if (ch == '?') { // ?: met
-                        operatorValue += ch;
-                        state = ACCEPT; 
-                    } else {
-                        raiseError("Unexpected character in question mark operator: ", curPos);
-                    }
-
-                    break;
-            }
+    // Punctuations:
+    //     ; ,
+    //     ::
+    //     => -> ?-> ...
+    //     [ ] { } ( )
 
-            curPos++;
+    // : or ::
+    if (ch == ':') {
+        if (curPos + 1 < sourceCodelength && sourceCode[curPos + 1] == ':') {
+            curPos++; // Go to the end of the token
+            subtype = TokenSubtype::PUNCTUATION_DOUBLE_COLON;
+        } else {
+            isPunctuation = false; // ':' is an operator, not punctuation
+        }
+    } 
+    // => or ->
+    else if (ch == '=' || ch == '-') {
+        if (curPos + 1 < sourceCodelength && sourceCode[curPos + 1] == '>') {
+            curPos++; // Go to the end of the token
+            subtype = ch == '=' ? TokenSubtype::PUNCTUATION_DOUBLE_ARROW : TokenSubtype::PUNCTUATION_ARROW;
+        } else {
+            isPunctuation = false; // '=' and '-' are operators, not punctuation
         }
+    }
+    // ?->
+    else if (ch == '?') {
+        if (curPos + 2 < sourceCodelength && sourceCode[curPos + 1] == '-' && sourceCode[curPos + 2] == '>') {
+            curPos += 2; // Go to the end of the token
+            subtype = TokenSubtype::PUNCTUATION_NULLSAFE_ARROW;
+        } else {
+            isPunctuation = false; // '?' is an operator, not punctuation
+        }
+    }
+    // ...
+    else if (ch == '.') {
+        if (curPos + 2 < sourceCodelength && sourceCode[curPos + 1] == '.' && sourceCode[curPos + 2] == '.') {
+            curPos += 2; // Go to the end of the token
+            subtype = TokenSubtype::PUNCTUATION_ELLIPSIS;
+        } else {
+            isPunctuation = false; // '.' is an operator, not punctuation
+        }
+    // Single character punctuation symbols e.g. '(', ']', ',' ect
+    } 
+    // Ommit '>', '?' operators
+    else if (ch == '>' || ch == '?') {
+        isPunctuation = false;
+    }
+    else if (!isPunctuationSymbol(ch)) {
+        isPunctuation = false; // Not a punctuation symbol
+    }
+    // Single character punctuation, subtypes are in the order of ";," and "()[]{}"
+    else if (ch == ';' || ch == ',') {
+        subtype = ch == ';' ? TokenSubtype::PUNCTUATION_SEMICOLON : TokenSubtype::PUNCTUATION_COMMA;
+    }
+    else {
+        subtype = addToSubtype(TokenSubtype::PUNCTUATION_LEFT_PARENTHESIS, std::string_view("()[]{}").find(ch));
+    }
 
-        curPos--; // Compensate the while's last curPos++ execution
-        return Token(TokenType::OPERATOR, operatorValue);
+    if (isPunctuation) {
+        tokens.onToken(TokenView{TokenType::PUNCTUATION, sourceCode.substr(startPos, curPos + 1 - startPos), subtype});
+        return true;
+    } else {
+        return false;
     }
 
-    // Checks if the ch is one of the symbles of the punctuation tokens.
-    bool isPunctuationSymbol(char ch) {
+}
 
-        const char punctuationSymbols[15] = {
-            ';', ',', '.',
-            ':',
-            '=', '?', '-', '>', '.',
-            '[', ']', '{', '}', '(', ')'
-        };
+bool PHPLexer::isAbleToExtractComment(TokenSink& tokens) {
+    LEXER_ALLOCATION_SCOPE("isAbleToExtractComment");
 
-        for (char symbol : punctuationSymbols) {
-            if (ch == symbol) {
-                return true;
-            }
-        }
-        return false;
+    if (trace) {
+        std::cout << "Checking for comment at position: " << curPos << std::endl;
     }
 
-    // Working with punctuation symbols:
-    // 1. Checks if the current position is a punctuation symbol
-    // 2. If it is, extracts the punctuation symbol(s) and adds a token to the list
-    // 3. Returns true if a punctuation symbol was found, false otherwise
-    bool isAbleToExtractPunctuation(std::list<Token>& tokens) {
+    enum STATE {
+        START,
+        SINGLE_DASH,
+        INLINE_COMMENT,
+        MULTI_LINE_COMMENT,
+        MULTI_LINE_COMMENT_END,
+        ACCEPT,
+        DECLINE
+    } state = START;
 
-        if (trace) {
-            std::cout << "Checking for punctuation at position: " << curPos << std::endl;
-        }
-
-        std::string value;
-        bool isPunctuation = true;
+    size_t startPos = curPos;
 
+    while (curPos < sourceCodelength && state != ACCEPT && state != DECLINE) {
         char ch = sourceCode[curPos];
-        value += ch;
 
-        // Punctuations:
-        //     ; ,
-        //     ::
-        //     => -> ?-> ...
-        //     [ ] { } ( )
-    
-        // : or ::
-        if (ch == ':') {
-            if (curPos + 1 < sourceCodelength && sourceCode[curPos + 1] == ':') {
-                value = "::";
-                curPos++; // Go to the end of the token
-            } else {
-                isPunctuation = false; // ':' is an operator, not punctuation
-            }
-        } 
-        // => or ->
-        else if (ch == '=' || ch == '-') {
-            if (curPos + 1 < sourceCodelength && sourceCode[curPos + 1] == '>') {
-                value += ">";
-                curPos++; // Go to the end of the token
-            } else {
-                isPunctuation = false; // '=' and '-' are operators, not punctuation
-            }
-        }
-        // ?->
-        else if (ch == '?') {
-            if (curPos + 2 < sourceCodelength && sourceCode[curPos + 1] == '-' && sourceCode[curPos + 2] == '>') {
-                curPos += 2; // Go to the end of the token
-                value = "?->";
-            } else {
-                isPunctuation = false; // '?' is an operator, not punctuation
-            }
-        }
-        // ...
-        else if (ch == '.') {
-            if (curPos + 2 < sourceCodelength && sourceCode[curPos + 1] == '.' && sourceCode[curPos + 2] == '.') {
-                value = "...";
-                curPos += 2; // Go to the end of the token
-            } else {
-                isPunctuation = false; // '.' is an operator, not punctuation
-            }
-        // Single character punctuation symbols e.g. '(', ']', ',' ect
-        } 
-        // Ommit '>', '?' operators
-        else if (ch == '>' || ch == '?') {
-            isPunctuation = false;
-        }
-        else if (!isPunctuationSymbol(ch)) {
-            isPunctuation = false; // Not a punctuation symbol
-        }
+        switch (state)
+        {
+            case START:
+                if (ch == '/') {
+                    state = SINGLE_DASH;
+                } else if (ch == '#') {
+                    state = INLINE_COMMENT;
+                }
+                 else {
+                    // Never reached if the method is called properly
+                    raiseError("Expected '/' at the start of comment", curPos);
+                }
+                break;
 
-        if (isPunctuation) {
-            tokens.push_back(Token(TokenType::PUNCTUATION, value));
-            return true;
-        } else {
-            return false;
-        }
+            case SINGLE_DASH:
+                if (ch == '/') {
+                    state = INLINE_COMMENT;
+                } else if (ch == '*') {
+                    state = MULTI_LINE_COMMENT;
+                } else {
+                    curPos--;
+                    state = DECLINE; // Not a comment
+                }
 
-    }
+                break;
 
-    // Working with comments:
-    // 1. Checks if the current position is the start of a comment
-    // 2. If it is, extracts the comment and adds a token to the list
-    // 3. Returns true if a comment was found, false otherwise
-    // The method uses Finite Automata to recognize comments
-    bool isAbleToExtractComment(std::list<Token>& tokens) {
+            case INLINE_COMMENT:
+                if (ch == '\n') { // The new line isn't a part of the comment
+                    state = ACCEPT;
+                    curPos--;
+                }
+                break;
 
-        if (trace) {
-            std::cout << "Checking for comment at position: " << curPos << std::endl;
-        }
+            case MULTI_LINE_COMMENT:
+                if (ch == '*') {
+                    state = MULTI_LINE_COMMENT_END;
+                }
+                break;
 
-        enum STATE {
-            START,
-            SINGLE_DASH,
-            INLINE_COMMENT,
-            MULTI_LINE_COMMENT,
-            MULTI_LINE_COMMENT_END,
-            ACCEPT,
-            DECLINE
-        } state = START;
-
-        std::string commentValue;
-
-        while (curPos < sourceCodelength && state != ACCEPT && state != DECLINE) {
-            char ch = sourceCode[curPos];
-
-            switch (state)
-            {
-                case START:
-                    if (ch == '/') {
-                        state = SINGLE_DASH;
-                    } else if (ch == '#') {
-                        state = INLINE_COMMENT;
-                    }
-                     else {
-                        // Never reached if the method is called properly
-                        raiseError("Expected '/' at the start of comment", curPos);
-                    }
-                    commentValue += ch;
-                    break;
-
-                case SINGLE_DASH:
-                    if (ch == '/') {
-                        state = INLINE_COMMENT;
-                    } else if (ch == '*') {
-                        state = MULTI_LINE_COMMENT;
-                    } else {
-                        curPos--;
-                        state = DECLINE; // Not a comment
-                    }
-                    commentValue += ch;
-
-                    break;
-
-                case INLINE_COMMENT:
-                    if (ch == '\n' || curPos == sourceCodelength-1) {
-                        state = ACCEPT;
-                        curPos--;
-                    } else {
-                        commentValue += ch;
-                    }
-                    break;
-
-                case MULTI_LINE_COMMENT:
-                    if (ch == '*') {
-                        state = MULTI_LINE_COMMENT_END;
-                    } else if (curPos == sourceCodelength-1) {
-                        raiseError("Unterminated multi-line comment", curPos);
-                    }
-                    commentValue += ch;
-                    break;
-
-                case MULTI_LINE_COMMENT_END:
-                    if (ch == '/') {
-                        state = ACCEPT; // End of multi-line comment
-                    } else if (curPos == sourceCodelength-1) {
-                        raiseError("Unterminated multi-line comment", curPos);
-                    } else {
-                        state = MULTI_LINE_COMMENT; // Continue multi-line comment
-                    }
-                    commentValue += ch;
-                
-                    break;
-            }
+            case MULTI_LINE_COMMENT_END:
+                if (ch == '/') {
+                    state = ACCEPT; // End of multi-line comment
+                } else if (ch != '*') { // The comment may end with any number of stars: /* **/
+                    state = MULTI_LINE_COMMENT; // Continue multi-line comment
+                }
+            
+                break;
 
-            curPos++;
+            default: // ACCEPT and DECLINE end the loop
+                break;
         }
 
-        curPos--; // Step back to leave curPos the last character of the token
-        if (state == ACCEPT) {
-            tokens.push_back(Token(TokenType::COMMENT, commentValue));
-            return true;
-        } else if (state == DECLINE) {
-            return false;
-        }
+        curPos++;
+    }
+
+    // The end of the code was reached inside the comment
+    if (state == INLINE_COMMENT) {
+        state = ACCEPT;
+    } else if (state == MULTI_LINE_COMMENT || state == MULTI_LINE_COMMENT_END) {
+        raiseError("Unterminated multi-line comment", sourceCodelength - 1);
+    }
 
+    curPos--; // Step back to leave curPos the last character of the token
+    if (state == ACCEPT) {
+        tokens.onToken(TokenView{TokenType::COMMENT, sourceCode.substr(startPos, curPos + 1 - startPos)});
+        return true;
     }
 
-};
\ No newline at end of file
+    curPos = startPos; // Not a comment, other routes start from the same position
+    return false;
+
+}
@@ -0,0 +1,310 @@
+#ifndef PHPLEXER_H
+#define PHPLEXER_H
+
+#include <string>
+#include <string_view>
+#include <list>
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+
+enum class TokenType {
+    COMMENT,
+    KEYWORD,
+    OPERATOR,
+    IDENTIFIER,
+    PUNCTUATION,
+    INTEGER,
+    FLOAT,
+    STRING,
+    BOOLEAN,
+    // Named so because NULL is a name in C++
+    NUL,
+    END_OF_FILE
+};
+
+// Exact kind of the tokens having a fixed spelling: keywords, operators, punctuation, booleans and NULL.
+// IDs are dense, so consumers switch on them instead of comparing values, and tokenSubtypeSpelling()
+// gives the text back. Other tokens (identifiers, numbers, strings, comments, end of file) have NONE.
+// The IDs are a part of the C ABI (PHPLEXER_SUBTYPE_* of phplexer.h): new subtypes go right before COUNT
+enum class TokenSubtype : uint8_t {
+    NONE,
+
+    // Keywords
+    KEYWORD_IF, KEYWORD_ELSE,
+    KEYWORD_DO, KEYWORD_WHILE, KEYWORD_FOR, KEYWORD_FOREACH, KEYWORD_BREAK, KEYWORD_CONTINUE,
+    KEYWORD_FUNCTION, KEYWORD_RETURN, KEYWORD_ECHO,
+
+    // Operators written as keywords
+    OPERATOR_AND, OPERATOR_OR, OPERATOR_XOR,
+
+    // Operators
+    OPERATOR_PLUS, OPERATOR_MINUS, OPERATOR_MULTIPLY, OPERATOR_DIVIDE, OPERATOR_MODULO, OPERATOR_CONCAT, // + - * / % .
+    OPERATOR_PLUS_ASSIGN, OPERATOR_MINUS_ASSIGN, OPERATOR_MULTIPLY_ASSIGN, // += -= *=
+    OPERATOR_DIVIDE_ASSIGN, OPERATOR_MODULO_ASSIGN, OPERATOR_CONCAT_ASSIGN, // /= %= .=
+    OPERATOR_ASSIGN, OPERATOR_EQUAL, OPERATOR_IDENTICAL, // = == ===
+    OPERATOR_NOT, OPERATOR_NOT_EQUAL, OPERATOR_NOT_IDENTICAL, // ! != !==
+    OPERATOR_LESS, OPERATOR_LESS_EQUAL, OPERATOR_SPACESHIP, OPERATOR_SHIFT_LEFT, OPERATOR_ARRAY_NOT_EQUAL, // < <= <=> << <>
+    OPERATOR_GREATER, OPERATOR_GREATER_EQUAL, OPERATOR_SHIFT_RIGHT, // > >= >>
+    OPERATOR_BITWISE_AND, OPERATOR_LOGICAL_AND, OPERATOR_BITWISE_OR, OPERATOR_LOGICAL_OR, // & && | ||
+    OPERATOR_BITWISE_XOR, OPERATOR_BITWISE_NOT, OPERATOR_COLON, OPERATOR_ERROR_CONTROL, // ^ ~ : @
+    OPERATOR_QUESTION, OPERATOR_NULL_COALESCING, // ? ??
+
+    // Punctuation
+    PUNCTUATION_SEMICOLON, PUNCTUATION_COMMA, // ; ,
+    PUNCTUATION_DOUBLE_COLON, PUNCTUATION_DOUBLE_ARROW, PUNCTUATION_ARROW, PUNCTUATION_NULLSAFE_ARROW, // :: => -> ?->
+    PUNCTUATION_ELLIPSIS, // ...
+    PUNCTUATION_LEFT_PARENTHESIS, PUNCTUATION_RIGHT_PARENTHESIS, // ( )
+    PUNCTUATION_LEFT_BRACKET, PUNCTUATION_RIGHT_BRACKET, // [ ]
+    PUNCTUATION_LEFT_BRACE, PUNCTUATION_RIGHT_BRACE, // { }
+
+    // Literals
+    BOOLEAN_TRUE, BOOLEAN_FALSE,
+    NUL,
+
+    COUNT // Number of subtypes, not a subtype
+};
+
+// Spelling of the subtype, e.g. "===" for OPERATOR_IDENTICAL, empty for NONE
+const char* tokenSubtypeSpelling(TokenSubtype subtype);
+
+struct Token{    
+    TokenType type;
+    std::string value;
+    TokenSubtype subtype;
+
+    Token(TokenType t, const std::string& v, TokenSubtype s = TokenSubtype::NONE) : type(t), value(v), subtype(s){}
+};
+
+// Name of the token type as it is written in the enum
+const char* tokenTypeName(TokenType type);
+
+// Token which value points into the source code instead of owning a copy.
+// Valid as long as the source code passed to the lexer is alive
+struct TokenView {
+    TokenType type;
+    TokenSubtype subtype; // Before the value, so it takes the padding and the token stays 24 bytes
+    std::string_view value;
+
+    TokenView() = default;
+    TokenView(TokenType t, std::string_view v, TokenSubtype s = TokenSubtype::NONE) : type(t), subtype(s), value(v) {}
+};
+
+// Receives tokens one by one as soon as the lexer extracts them,
+// lets consumers process tokens without storing them
+class TokenSink {
+public:
+    virtual ~TokenSink() = default;
+    virtual void onToken(const TokenView& token) = 0;
+};
+
+// Sink collecting tokens into a vector
+class VectorTokenSink: public TokenSink {
+private:
+    std::vector<TokenView>& tokens;
+public:
+    explicit VectorTokenSink(std::vector<TokenView>& t) : tokens(t) {}
+
+    void onToken(const TokenView& token) override;
+};
+
+// Pairs of brackets ( ) [ ] { } of the token list, built while lexing.
+// matches[i] is the index of the token paired with the bracket token i, so consumers can
+// jump over any bracketed region at once; NO_MATCH for other tokens and unpaired brackets.
+// unbalanced keeps indices of the brackets without a pair, in the order of tokens
+struct BracketIndex {
+    static constexpr size_t NO_MATCH = SIZE_MAX;
+
+    std::vector<size_t> matches;
+    std::vector<size_t> unbalanced;
+
+    // Working stack of the lexing, kept to reuse its memory
+    struct OpenBracket {
+        size_t tokenIndex;
+        char bracket;
+    };
+    std::vector<OpenBracket> openBrackets;
+    size_t openCounts[3] = {}; // Number of ( [ { in openBrackets
+
+    void clear() {
+        matches.clear();
+        unbalanced.clear();
+        openBrackets.clear();
+        openCounts[0] = openCounts[1] = openCounts[2] = 0;
+    }
+};
+
+// Sink pairing brackets into the BracketIndex and passing every token further to the next sink.
+// A closing bracket closes the last opened bracket of its kind, brackets opened after that one
+// are unbalanced. A closing bracket with nothing to close is unbalanced too
+class BracketMatcher: public TokenSink {
+private:
+    TokenSink& next;
+    BracketIndex& index;
+public:
+    BracketMatcher(TokenSink& n, BracketIndex& i) : next(n), index(i) {}
+
+    void onToken(const TokenView& token) override;
+};
+
+// Custom exception
+class LexerException: public std::runtime_error {
+public:
+    explicit LexerException(const std::string& message) 
+    : runtime_error(message) { }
+};
+
+// Class reads sourceCode of PHP script and translates it into tokens,
+// giving tokens types and values (original)
+// Usage: first call setSourceCode method, then retrieve tokens via getTokens() method
+// For high rate lexing use setSourceView() and getTokens(std::vector<TokenView>&):
+// they neither copy the source code nor allocate when the vector is reused
+class PHPLexer
+{
+private:
+    std::string ownedSourceCode; // Storage for the code passed to setSourceCode()
+    std::string_view sourceCode; // Code being lexed, points either to ownedSourceCode or to the caller's memory
+    std::vector<TokenView> tokenViews; // Reused by getTokens() returning the list
+    size_t curPos; // Currect position
+    size_t line; // Number of lines
+    size_t sourceCodelength; // Extracted to evoid multiple invoking sourceCode.length()
+    bool trace = false; // If true, prints debug information
+    bool utf8Validation = false; // If true, the code is checked to be valid UTF-8 before lexing
+    std::vector<size_t> invalidUtf8Offsets; // Found by the last UTF-8 validation
+
+    // List of all keywords
+    std::string keywords[11] = {
+         "if", "else",
+         "do", "while", "for", "foreach", "break", "continue",
+         "function", "return", "echo"
+         // Add keywords if needed
+    };
+
+    // List of operators written as keywords
+    std::string keywordOperators[3] = {
+        "and", "or", "xor"
+    };
+
+    // Operators (except the ones written as keywords)
+    // Source: https://www.w3schools.com/php/php_operators.asp
+    std::string operators[33] = {
+        "+", "-", "*", "/", "%", // Arithmetic operators
+        "=", "+=", "-=", "*=", "/=", "%=", // Assignment operators
+        "==", "===" "!=", "!==", "<", ">", "<=", ">=", "<=>", // Comparison operators
+        "<>" // Not equals for arrays
+        "&&", "||", "!", // Logical operators
+        "&", "|", "^", "~", "<<", ">>", // Bitwise operators
+        ".=", ".", // String operators
+        "?", ":", "??" // Conditional operators
+    };
+
+    // Byte classes are checked without <cctype>: isalpha() of a negative char is undefined
+    // behaviour and the result depends on the locale.
+    // As in PHP, bytes 0x80-0xFF are letters in names, so UTF-8 names (e.g. $змінна) are allowed
+    static bool isLetter(char ch);
+    static bool isDigit(char ch);
+    static bool isNameStart(char ch);
+    static bool isNameChar(char ch);
+
+public:
+
+    // Sets the input sourceCode, the lexer keeps its own copy
+    void setSourceCode(const std::string& code);
+
+    // Sets the input sourceCode without copying it.
+    // The caller keeps the code alive while lexing and while using the TokenViews
+    void setSourceView(std::string_view code);
+
+    void setSourceView(const char* code, size_t length) {
+        setSourceView(std::string_view(code, length));
+    }
+
+    // If the lexer should print messages to the console
+    void setTrace(bool t) {
+        trace = t;
+    }
+
+    // If the lexer should check the code to be valid UTF-8 before lexing it.
+    // Invalid sequences don't stop lexing, they are reported by getInvalidUtf8Offsets()
+    void setUtf8Validation(bool v) {
+        utf8Validation = v;
+    }
+
+    // Offsets of invalid UTF-8 sequences found by the last getTokens() call
+    const std::vector<size_t>& getInvalidUtf8Offsets() const {
+        return invalidUtf8Offsets;
+    }
+    
+    // Retrieving tokens from the sourceCode
+    // Should be called after invoking setSourceCode() method
+    // Returns a list of Toknes always ending with END_OF_FILE token
+    // May throw LexerExcetion
+    std::list<Token> getTokens();
+
+    // Same as getTokens(), but writes TokenViews into the given vector.
+    // The vector is cleared first, its capacity is kept, so reusing it between
+    // calls makes lexing free of heap allocations
+    void getTokens(std::vector<TokenView>& tokens);
+
+    // Same as getTokens(), but passes every token to the sink right after extracting it.
+    // Nothing is stored by the lexer, the last token is always END_OF_FILE
+    void getTokens(TokenSink& tokens);
+
+    // Same as getTokens(std::vector<TokenView>&), also fills the BracketIndex of the tokens
+    void getTokens(std::vector<TokenView>& tokens, BracketIndex& brackets);
+
+    // Helping method to raise error.
+    // Takes the beggining and the end of the words, find "broken" spot and
+    // puts it in the thrown LexerException.
+    // If curPos is on the whitespace, then takes two near words
+    [[noreturn]] void raiseError(std::string message, int pos);
+
+    // Extracts an indentifier from the current position.
+    // Uses Finite Automata to recognize identifiers.
+    TokenView extractIdenetifier();
+
+    // Extracts a keyword, a keyword operators ('and', 'or', 'xor') or 'NULL' from the currect position
+    // Uses almost Finite Automata to recognize keywords
+    TokenView extractKeyword_KeywordOperator_Null();
+
+    // Extracts a string from the current position
+    // Uses (alomst) Finite Automata to recognize strings:
+    // has quotChar memory slot to keep it simple
+    TokenView extractString();
+
+    // Extracts a number (integer or float) from the current position
+    // Uses Finite Automata
+    TokenView extractIntegerOrFloat();
+
+    // Working with booleans:
+    // 1. Tries to extract a boolean value
+    // 2. If a boolean value is found, adds approriate token to the list
+    // 3. Returns true if a boolean value was found, false otherwise
+    bool isAbleToExtractBoolean(TokenSink& tokens);
+
+    // Checks if the character is an operator symbol like +, =, ? ect
+    bool isOperatorSymbol(char ch);
+
+    // Extracts an operator from the current position
+    // Uses Finite Automata to recognize operators
+    TokenView extractOperator();
+
+    // Checks if the ch is one of the symbles of the punctuation tokens.
+    bool isPunctuationSymbol(char ch);
+
+    // Working with punctuation symbols:
+    // 1. Checks if the current position is a punctuation symbol
+    // 2. If it is, extracts the punctuation symbol(s) and adds a token to the list
+    // 3. Returns true if a punctuation symbol was found, false otherwise
+    bool isAbleToExtractPunctuation(TokenSink& tokens);
+
+    // Working with comments:
+    // 1. Checks if the current position is the start of a comment
+    // 2. If it is, extracts the comment and adds a token to the list
+    // 3. Returns true if a comment was found, false otherwise
+    // The method uses Finite Automata to recognize comments
+    bool isAbleToExtractComment(TokenSink& tokens);
+
+};
+
+#endif
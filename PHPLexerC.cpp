@@ -0,0 +1,174 @@
+#include <cstring>
+#include "phplexer.h"
+#include "PHPLexer.h"
+
+static_assert(PHPLEXER_TOKEN_COMMENT == static_cast<int>(TokenType::COMMENT), "Token types of the C interface must match TokenType");
+static_assert(PHPLEXER_TOKEN_IDENTIFIER == static_cast<int>(TokenType::IDENTIFIER), "Token types of the C interface must match TokenType");
+static_assert(PHPLEXER_TOKEN_END_OF_FILE == static_cast<int>(TokenType::END_OF_FILE), "Token types of the C interface must match TokenType");
+
+// Subtype IDs are a part of the ABI, so each one is checked
+#define CHECK_SUBTYPE(name) static_assert(PHPLEXER_SUBTYPE_##name == static_cast<int>(TokenSubtype::name), \
+    "Subtypes of the C interface must match TokenSubtype")
+CHECK_SUBTYPE(NONE);
+CHECK_SUBTYPE(KEYWORD_IF);
+CHECK_SUBTYPE(KEYWORD_ELSE);
+CHECK_SUBTYPE(KEYWORD_DO);
+CHECK_SUBTYPE(KEYWORD_WHILE);
+CHECK_SUBTYPE(KEYWORD_FOR);
+CHECK_SUBTYPE(KEYWORD_FOREACH);
+CHECK_SUBTYPE(KEYWORD_BREAK);
+CHECK_SUBTYPE(KEYWORD_CONTINUE);
+CHECK_SUBTYPE(KEYWORD_FUNCTION);
+CHECK_SUBTYPE(KEYWORD_RETURN);
+CHECK_SUBTYPE(KEYWORD_ECHO);
+CHECK_SUBTYPE(OPERATOR_AND);
+CHECK_SUBTYPE(OPERATOR_OR);
+CHECK_SUBTYPE(OPERATOR_XOR);
+CHECK_SUBTYPE(OPERATOR_PLUS);
+CHECK_SUBTYPE(OPERATOR_MINUS);
+CHECK_SUBTYPE(OPERATOR_MULTIPLY);
+CHECK_SUBTYPE(OPERATOR_DIVIDE);
+CHECK_SUBTYPE(OPERATOR_MODULO);
+CHECK_SUBTYPE(OPERATOR_CONCAT);
+CHECK_SUBTYPE(OPERATOR_PLUS_ASSIGN);
+CHECK_SUBTYPE(OPERATOR_MINUS_ASSIGN);
+CHECK_SUBTYPE(OPERATOR_MULTIPLY_ASSIGN);
+CHECK_SUBTYPE(OPERATOR_DIVIDE_ASSIGN);
+CHECK_SUBTYPE(OPERATOR_MODULO_ASSIGN);
+CHECK_SUBTYPE(OPERATOR_CONCAT_ASSIGN);
+CHECK_SUBTYPE(OPERATOR_ASSIGN);
+CHECK_SUBTYPE(OPERATOR_EQUAL);
+CHECK_SUBTYPE(OPERATOR_IDENTICAL);
+CHECK_SUBTYPE(OPERATOR_NOT);
+CHECK_SUBTYPE(OPERATOR_NOT_EQUAL);
+CHECK_SUBTYPE(OPERATOR_NOT_IDENTICAL);
+CHECK_SUBTYPE(OPERATOR_LESS);
+CHECK_SUBTYPE(OPERATOR_LESS_EQUAL);
+CHECK_SUBTYPE(OPERATOR_SPACESHIP);
+CHECK_SUBTYPE(OPERATOR_SHIFT_LEFT);
+CHECK_SUBTYPE(OPERATOR_ARRAY_NOT_EQUAL);
+CHECK_SUBTYPE(OPERATOR_GREATER);
+CHECK_SUBTYPE(OPERATOR_GREATER_EQUAL);
+CHECK_SUBTYPE(OPERATOR_SHIFT_RIGHT);
+CHECK_SUBTYPE(OPERATOR_BITWISE_AND);
+CHECK_SUBTYPE(OPERATOR_LOGICAL_AND);
+CHECK_SUBTYPE(OPERATOR_BITWISE_OR);
+CHECK_SUBTYPE(OPERATOR_LOGICAL_OR);
+CHECK_SUBTYPE(OPERATOR_BITWISE_XOR);
+CHECK_SUBTYPE(OPERATOR_BITWISE_NOT);
+CHECK_SUBTYPE(OPERATOR_COLON);
+CHECK_SUBTYPE(OPERATOR_ERROR_CONTROL);
+CHECK_SUBTYPE(OPERATOR_QUESTION);
+CHECK_SUBTYPE(OPERATOR_NULL_COALESCING);
+CHECK_SUBTYPE(PUNCTUATION_SEMICOLON);
+CHECK_SUBTYPE(PUNCTUATION_COMMA);
+CHECK_SUBTYPE(PUNCTUATION_DOUBLE_COLON);
+CHECK_SUBTYPE(PUNCTUATION_DOUBLE_ARROW);
+CHECK_SUBTYPE(PUNCTUATION_ARROW);
+CHECK_SUBTYPE(PUNCTUATION_NULLSAFE_ARROW);
+CHECK_SUBTYPE(PUNCTUATION_ELLIPSIS);
+CHECK_SUBTYPE(PUNCTUATION_LEFT_PARENTHESIS);
+CHECK_SUBTYPE(PUNCTUATION_RIGHT_PARENTHESIS);
+CHECK_SUBTYPE(PUNCTUATION_LEFT_BRACKET);
+CHECK_SUBTYPE(PUNCTUATION_RIGHT_BRACKET);
+CHECK_SUBTYPE(PUNCTUATION_LEFT_BRACE);
+CHECK_SUBTYPE(PUNCTUATION_RIGHT_BRACE);
+CHECK_SUBTYPE(BOOLEAN_TRUE);
+CHECK_SUBTYPE(BOOLEAN_FALSE);
+CHECK_SUBTYPE(NUL);
+#undef CHECK_SUBTYPE
+static_assert(PHPLEXER_SUBTYPE_NUL + 1 == static_cast<int>(TokenSubtype::COUNT), "Every subtype must have a constant of the C interface");
+
+namespace {
+
+    // Thrown when the arena has no place for the next token
+    class ArenaFullException: public std::exception {};
+
+    // Sink writing tokens right into the caller's arena
+    class ArenaTokenSink: public TokenSink {
+    private:
+        phplexer_arena& arena;
+        const char* sourceStart;
+    public:
+        ArenaTokenSink(phplexer_arena& a, const char* s) : arena(a), sourceStart(s) {}
+
+        void onToken(const TokenView& token) override {
+            if (arena.used == arena.capacity) {
+                throw ArenaFullException();
+            }
+            phplexer_token& out = arena.tokens[arena.used++];
+            out.type = static_cast<uint32_t>(token.type);
+            out.subtype = static_cast<uint32_t>(token.subtype);
+            out.offset = token.value.data() - sourceStart;
+            out.length = token.value.length();
+        }
+    };
+
+    void setError(phplexer_result& result, int32_t status, const char* message) {
+        result.status = status;
+        strncpy(result.error, message, sizeof(result.error) - 1);
+        result.error[sizeof(result.error) - 1] = '\0';
+    }
+}
+
+extern "C" size_t phplexer_lex_batch(const phplexer_input* inputs, size_t count,
+                                     phplexer_arena* arena, phplexer_result* results) {
+
+    // Kept warm between calls of the thread
+    thread_local PHPLexer lexer;
+
+    size_t succeeded = 0;
+
+    for (size_t i = 0; i < count; i++) {
+
+        phplexer_result& result = results[i];
+        result.status = PHPLEXER_OK;
+        result.reserved = 0;
+        result.first_token = arena->used;
+        result.token_count = 0;
+        result.error[0] = '\0';
+
+        const char* data = inputs[i].data != nullptr ? inputs[i].data : "";
+        ArenaTokenSink sink(*arena, data);
+
+        // Exceptions must not cross the C boundary
+        try {
+            lexer.setSourceView(data, inputs[i].data != nullptr ? inputs[i].length : 0);
+            lexer.getTokens(sink);
+            result.token_count = arena->used - result.first_token;
+            succeeded++;
+        } catch (const ArenaFullException&) {
+            setError(result, PHPLEXER_ARENA_FULL, "Arena is full");
+        } catch (const LexerException& e) {
+            setError(result, PHPLEXER_LEXER_ERROR, e.what());
+        } catch (const std::exception& e) {
+            setError(result, PHPLEXER_INTERNAL_ERROR, e.what());
+        } catch (...) {
+            setError(result, PHPLEXER_INTERNAL_ERROR, "Unknown error");
+        }
+
+        if (result.status != PHPLEXER_OK) {
+            arena->used = result.first_token; // Tokens of the failed input are dropped
+        }
+    }
+
+    return succeeded;
+}
+
+extern "C" const char* phplexer_token_type_name(uint32_t type) {
+    if (type > static_cast<uint32_t>(TokenType::END_OF_FILE)) {
+        return "UNKNOWN";
+    }
+    return tokenTypeName(static_cast<TokenType>(type));
+}
+
+extern "C" const char* phplexer_token_subtype_spelling(uint32_t subtype) {
+    if (subtype >= static_cast<uint32_t>(TokenSubtype::COUNT)) {
+        return "";
+    }
+    return tokenSubtypeSpelling(static_cast<TokenSubtype>(subtype));
+}
+
+extern "C" uint32_t phplexer_abi_version(void) {
+    return PHPLEXER_ABI_VERSION;
+}
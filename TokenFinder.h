@@ -0,0 +1,333 @@
+#ifndef TOKEN_FINDER_H
+#define TOKEN_FINDER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "PHPLexer.h"
+
+// Adds positions of all occurrences of the needle in the text to positions (in increasing order).
+// Candidates are found by comparing the first and the last bytes of the needle with 16 positions
+// at once (SSE2), only positions where both bytes match are compared completely
+inline void findAllOccurrences(std::string_view text, std::string_view needle, std::vector<size_t>& positions) {
+
+    size_t n = needle.length();
+    if (n == 0 || n > text.length()) {
+        return;
+    }
+
+    const char* data = text.data();
+    size_t lastStart = text.length() - n; // The last position the needle may start at
+    size_t pos = 0;
+
+#ifdef __SSE2__
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[n - 1]);
+
+    while (pos + 16 <= lastStart + 1) {
+        __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + n - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last)));
+
+        while (mask != 0) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(data + pos + bit + 1, needle.data() + 1, n - 1) == 0 || n == 1) {
+                positions.push_back(pos + bit);
+            }
+            mask &= mask - 1;
+        }
+        pos += 16;
+    }
+#endif
+
+    // The rest (or everything without SSE2)
+    while (pos <= lastStart) {
+        const void* found = memchr(data + pos, needle[0], lastStart + 1 - pos);
+        if (found == nullptr) {
+            break;
+        }
+        pos = static_cast<const char*>(found) - data;
+        if (memcmp(data + pos, needle.data(), n) == 0) {
+            positions.push_back(pos);
+        }
+        pos++;
+    }
+}
+
+// What is searched: tokens of the type with the value (or with the value prefix)
+struct TokenPredicate {
+    TokenType type;
+    std::string value;
+    bool isPrefix;
+
+    bool matches(const TokenView& token) const {
+        if (token.type != type) {
+            return false;
+        }
+        if (isPrefix) {
+            return token.value.substr(0, value.length()) == value;
+        }
+        return token.value == value;
+    }
+};
+
+// Parses the predicate written as <type>:<value> or <type>:<prefix>* (e.g. identifier:$_GET, keyword:echo).
+// Returns false if it's malformed
+inline bool parseTokenPredicate(const std::string& text, TokenPredicate& predicate) {
+
+    size_t colon = text.find(':');
+    if (colon == std::string::npos || colon + 1 == text.length()) {
+        return false;
+    }
+
+    std::string typeName = text.substr(0, colon);
+    for (char& ch : typeName) {
+        ch = toupper(static_cast<unsigned char>(ch));
+    }
+
+    bool isTypeFound = false;
+    for (int i = 0; i <= static_cast<int>(TokenType::END_OF_FILE); i++) {
+        if (typeName == tokenTypeName(static_cast<TokenType>(i))) {
+            predicate.type = static_cast<TokenType>(i);
+            isTypeFound = true;
+        }
+    }
+    if (!isTypeFound) {
+        return false;
+    }
+
+    predicate.value = text.substr(colon + 1);
+    predicate.isPrefix = predicate.value.back() == '*' && predicate.value.length() > 1;
+    if (predicate.isPrefix) {
+        predicate.value.pop_back();
+    }
+    return true;
+}
+
+// Found token
+struct TokenHit {
+    size_t line;
+    size_t offset;
+    std::string_view value;
+};
+
+// Looks for tokens matching the predicates without lexing the whole code:
+//     1. Occurrences of the predicates' values are looked for as plain text (files without them are skipped)
+//     2. A light scanner goes through the code tracking only strings and comments,
+//        so occurrences inside them are thrown away and line numbers are known
+//     3. For the rest, the lexer runs from the nearest token boundary before the occurrence
+//        (whitespace or the end of a string or comment) until there are no more occurrences close ahead
+// The scanner follows the lexer's rules for strings and comments, so the tokens found are the same
+// as the full lexing gives, except that a lexer error elsewhere in the file doesn't hide them
+class TokenFinder
+{
+private:
+    const std::vector<TokenPredicate>& predicates;
+    PHPLexer lexer;
+    std::vector<size_t> candidates;
+
+    // Occurrences are looked for in blocks of this size, so the candidates don't take memory proportional to the code
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    // Lexing goes on while the next occurrence is this close, stopping it costs more than lexing that much
+    static constexpr size_t MAX_CANDIDATES_GAP = 256;
+
+    // Thrown by the sink to stop lexing when there are no more occurrences close ahead
+    class StopException: public std::exception {};
+
+    // Scanner of strings and comments, moves only forward
+    class ContextScanner {
+    private:
+        enum STATE {
+            CODE,
+            STRING,
+            INLINE_COMMENT,
+            MULTI_LINE_COMMENT,
+            MULTI_LINE_COMMENT_END
+        } state = CODE;
+
+        std::string_view code;
+        char quoteChar = '\0';
+
+    public:
+        size_t pos = 0;
+        size_t line = 1;
+        size_t tokenBoundary = 0; // The last position in the code where a token may start for sure
+
+        explicit ContextScanner(std::string_view c) : code(c) {}
+
+        bool isInCode() const {
+            return state == CODE;
+        }
+
+        // Processes all the characters before the target position
+        void advanceTo(size_t target) {
+            for (; pos < target; pos++) {
+                char ch = code[pos];
+                if (ch == '\n') {
+                    line++;
+                }
+
+                switch (state) {
+                    case CODE:
+                        if (ch == '"' || ch == '\'') {
+                            quoteChar = ch;
+                            state = STRING;
+                        } else if (ch == '#') {
+                            state = INLINE_COMMENT;
+                        } else if (ch == '/' && pos + 1 < code.length() && (code[pos + 1] == '/' || code[pos + 1] == '*')) {
+                            state = code[pos + 1] == '/' ? INLINE_COMMENT : MULTI_LINE_COMMENT;
+                            pos++; // The second character of the comment start is never a new line
+                        } else if (ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r') {
+                            tokenBoundary = pos + 1;
+                        }
+                        break;
+
+                    case STRING:
+                        // An unterminated string is an error of the lexer, the new line is just a boundary here
+                        if (ch == quoteChar || ch == '\n') {
+                            state = CODE;
+                            tokenBoundary = pos + 1;
+                        }
+                        break;
+
+                    case INLINE_COMMENT:
+                        if (ch == '\n') {
+                            state = CODE;
+                            tokenBoundary = pos + 1;
+                        }
+                        break;
+
+                    // Same transitions as in PHPLexer::isAbleToExtractComment
+                    case MULTI_LINE_COMMENT:
+                        if (ch == '*') {
+                            state = MULTI_LINE_COMMENT_END;
+                        }
+                        break;
+
+                    case MULTI_LINE_COMMENT_END:
+                        if (ch == '/') {
+                            state = CODE;
+                            tokenBoundary = pos + 1;
+                        } else if (ch != '*') {
+                            state = MULTI_LINE_COMMENT;
+                        }
+                        break;
+                }
+            }
+        }
+    };
+
+    // Sink checking tokens starting at the occurrences, candidates are positions of the occurrences in the code
+    class CandidateSink: public TokenSink {
+    public:
+        const std::vector<TokenPredicate>* predicates;
+        const std::vector<size_t>* candidates;
+        size_t nextCandidate = 0; // Index of the first candidate not passed yet
+        size_t restartPos = 0; // End of the last token, lexing may start there
+        std::string_view sourceCode;
+        ContextScanner* scanner;
+        std::vector<TokenHit>* hits;
+
+        void onToken(const TokenView& token) override {
+
+            size_t pos = token.value.data() - sourceCode.data();
+            size_t endPos = pos + token.value.length();
+
+            // Occurrences before the token start are in the middle of tokens, e.g. "echo" in $echo
+            while (nextCandidate < candidates->size() && (*candidates)[nextCandidate] < pos) {
+                nextCandidate++;
+            }
+            if (nextCandidate == candidates->size()) {
+                // After all the candidates known, the token may start at a candidate of the next block
+                throw StopException();
+            }
+
+            if ((*candidates)[nextCandidate] == pos) {
+                for (const auto& predicate : *predicates) {
+                    if (predicate.matches(token)) {
+                        scanner->advanceTo(pos);
+                        hits->push_back(TokenHit{scanner->line, pos, token.value});
+                        break;
+                    }
+                }
+                nextCandidate++;
+            }
+
+            restartPos = endPos;
+            if (nextCandidate == candidates->size() || (*candidates)[nextCandidate] > endPos + MAX_CANDIDATES_GAP) {
+                throw StopException();
+            }
+        }
+    };
+
+public:
+    explicit TokenFinder(const std::vector<TokenPredicate>& p) : predicates(p) {}
+
+    // Adds tokens of the code matching any of the predicates to hits, in the order of the code
+    void find(std::string_view sourceCode, std::vector<TokenHit>& hits) {
+
+        ContextScanner scanner(sourceCode);
+        CandidateSink sink;
+        sink.predicates = &predicates;
+        sink.candidates = &candidates;
+        sink.sourceCode = sourceCode;
+        sink.scanner = &scanner;
+        sink.hits = &hits;
+
+        // Lexing from this position failed, the candidates are skipped until there is a new position to start from
+        size_t failedPos = SIZE_MAX;
+
+        for (size_t blockStart = 0; blockStart < sourceCode.length(); blockStart += BLOCK_SIZE) {
+
+            // Occurrences starting in the block (they may end after it), as positions in the code
+            candidates.clear();
+            size_t blockLength = std::min(BLOCK_SIZE, sourceCode.length() - blockStart);
+            for (const auto& predicate : predicates) {
+                std::string_view text = sourceCode.substr(blockStart, blockLength + predicate.value.length() - 1);
+                size_t firstNew = candidates.size();
+                findAllOccurrences(text, predicate.value, candidates);
+                while (candidates.size() > firstNew && candidates.back() >= blockLength) {
+                    candidates.pop_back(); // Starts in the next block, found there again
+                }
+                for (size_t i = firstNew; i < candidates.size(); i++) {
+                    candidates[i] += blockStart;
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+            sink.nextCandidate = 0;
+            while (sink.nextCandidate < candidates.size()) {
+
+                size_t candidate = candidates[sink.nextCandidate];
+                if (candidate < sink.restartPos) {
+                    sink.nextCandidate++; // Inside a token lexed already
+                    continue;
+                }
+
+                scanner.advanceTo(candidate);
+                size_t startPos = std::max(scanner.tokenBoundary, sink.restartPos);
+                if (!scanner.isInCode() || startPos == failedPos) {
+                    sink.nextCandidate++; // Inside a string or a comment, or in broken code
+                    continue;
+                }
+
+                try {
+                    lexer.setSourceView(sourceCode.substr(startPos));
+                    lexer.getTokens(sink);
+                } catch (const StopException&) {
+                } catch (const LexerException&) {
+                    failedPos = startPos; // Broken code near the candidate
+                }
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef TOKEN_FINGERPRINT_H
+#define TOKEN_FINGERPRINT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "PHPLexer.h"
+
+// Fingerprint of k consecutive (normalised) tokens.
+// offset is the position of the first token of the k-gram in the source code
+struct Fingerprint {
+    uint64_t hash;
+    size_t offset;
+};
+
+// Computes winnowing fingerprints of the token stream for clone detection.
+// Works as a TokenSink, so fingerprints are computed while lexing and tokens are never stored:
+//     1. Every token is normalised and hashed (comments are skipped, identifiers and literals
+//        are replaced by a placeholder of their type, so renamed copies still match)
+//     2. Rolling hash of the last k token hashes gives a k-gram hash
+//     3. From every window of w consecutive k-gram hashes the minimal one is selected (winnowing),
+//        selected hashes are the fingerprints of the code
+// Memory used doesn't depend on the size of the code, except the fingerprints themselves.
+// Usage: call reset() with the source code, pass the fingerprinter to PHPLexer::getTokens(),
+// then read getFingerprints()
+class TokenFingerprinter: public TokenSink
+{
+private:
+    // Base of the polynomial rolling hash
+    static const uint64_t BASE = 1099511628211ULL;
+
+    size_t k; // Number of tokens in a k-gram
+    size_t w; // Number of k-grams in a winnowing window
+    bool normaliseIdentifiers;
+    bool normaliseLiterals;
+
+    const char* sourceStart = nullptr; // To turn token views into offsets
+
+    // Circular buffers of the last k tokens
+    std::vector<uint64_t> tokenHashes;
+    std::vector<size_t> tokenOffsets;
+    size_t tokenCount = 0;
+    uint64_t kgramHash = 0;
+    uint64_t basePowerK = 1; // BASE^(k-1), to remove the oldest token from the rolling hash
+
+    // Circular buffer of the last w k-gram hashes
+    std::vector<Fingerprint> window;
+    size_t kgramCount = 0;
+    size_t minIndex = 0; // Number of the k-gram selected in the current window
+    bool hasSelected = false;
+
+    std::vector<Fingerprint> fingerprints;
+
+    // FNV-1a hash of the normalised token
+    uint64_t hashToken(const TokenView& token) {
+
+        uint64_t hash = 14695981039346656037ULL;
+        hash = (hash ^ static_cast<uint64_t>(token.type)) * 1099511628211ULL;
+
+        bool isLiteral = token.type == TokenType::INTEGER || token.type == TokenType::FLOAT
+            || token.type == TokenType::STRING || token.type == TokenType::BOOLEAN || token.type == TokenType::NUL;
+
+        if ((token.type == TokenType::IDENTIFIER && normaliseIdentifiers) || (isLiteral && normaliseLiterals)) {
+            return hash; // Placeholder, only the type is hashed
+        }
+
+        for (char ch : token.value) {
+            hash = (hash ^ static_cast<unsigned char>(ch)) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // Adds the k-gram hash to the winnowing window and selects the fingerprint if needed
+    void addKgram(uint64_t hash, size_t offset) {
+
+        window[kgramCount % w] = Fingerprint{hash, offset};
+        kgramCount++;
+
+        if (kgramCount < w) {
+            return; // The first window is not full yet
+        }
+
+        size_t windowStart = kgramCount - w;
+
+        if (!hasSelected || minIndex < windowStart) {
+            // Selected k-gram left the window, looking for the rightmost minimum of the whole window
+            minIndex = windowStart;
+            for (size_t i = windowStart; i < kgramCount; i++) {
+                if (window[i % w].hash <= window[minIndex % w].hash) {
+                    minIndex = i;
+                }
+            }
+            hasSelected = true;
+            fingerprints.push_back(window[minIndex % w]);
+        }
+        else if (hash <= window[minIndex % w].hash) {
+            // The new k-gram is the new minimum
+            minIndex = kgramCount - 1;
+            fingerprints.push_back(window[minIndex % w]);
+        }
+    }
+
+public:
+
+    // k-grams and windows are at least one long, 0 is taken as 1
+    TokenFingerprinter(size_t kgramLength = 5, size_t windowLength = 4,
+        bool normaliseIdentifiers = true, bool normaliseLiterals = true)
+    : k(kgramLength > 0 ? kgramLength : 1), w(windowLength > 0 ? windowLength : 1),
+      normaliseIdentifiers(normaliseIdentifiers), normaliseLiterals(normaliseLiterals),
+      tokenHashes(k), tokenOffsets(k), window(w) {
+
+        for (size_t i = 1; i < k; i++) {
+            basePowerK *= BASE;
+        }
+    }
+
+    // Prepares the fingerprinter for the new code, previous fingerprints are cleared
+    void reset(std::string_view sourceCode) {
+        sourceStart = sourceCode.data();
+        tokenCount = 0;
+        kgramHash = 0;
+        kgramCount = 0;
+        hasSelected = false;
+        fingerprints.clear();
+    }
+
+    void onToken(const TokenView& token) override {
+
+        if (token.type == TokenType::COMMENT) {
+            return;
+        }
+
+        if (token.type == TokenType::END_OF_FILE) {
+            // Code shorter than a window still gets a fingerprint
+            if (kgramCount > 0 && kgramCount < w) {
+                size_t best = 0;
+                for (size_t i = 0; i < kgramCount; i++) {
+                    if (window[i].hash <= window[best].hash) {
+                        best = i;
+                    }
+                }
+                fingerprints.push_back(window[best]);
+            }
+            return;
+        }
+
+        uint64_t hash = hashToken(token);
+        size_t slot = tokenCount % k;
+
+        if (tokenCount >= k) {
+            kgramHash -= tokenHashes[slot] * basePowerK; // Removing the oldest token
+        }
+        kgramHash = kgramHash * BASE + hash;
+
+        tokenHashes[slot] = hash;
+        tokenOffsets[slot] = token.value.data() - sourceStart;
+        tokenCount++;
+
+        if (tokenCount >= k) {
+            addKgram(kgramHash, tokenOffsets[tokenCount % k]);
+        }
+    }
+
+    const std::vector<Fingerprint>& getFingerprints() const {
+        return fingerprints;
+    }
+};
+
+#endif
@@ -0,0 +1,540 @@
+#ifndef TOKEN_INDEX_H
+#define TOKEN_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "PHPLexer.h"
+#include "LexerPipeline.h"
+
+// Persistent inverted index of the identifier and keyword values of a directory, used by the --index and --lookup modes.
+// It's built by lexing the files in parallel. Rebuilding lexes only the files changed since (by size and modification time),
+// postings of the other files are taken from the previous index. The index is written whole and renamed over the old one,
+// so a reader mapping the old index is never disturbed.
+//
+// Layout (integers in the byte order of the machine, the version check rejects an index of another order;
+// sections are 8-byte aligned):
+//     header   - TokenIndexHeader
+//     files    - TokenIndexFile per file, sorted by path
+//     terms    - TokenIndexTerm per value, sorted by value (bytewise) to be found by binary search
+//     strings  - paths and values, referenced by offset and length
+//     postings - per term: (file, offset, line) of each token sorted by file and offset, as varints:
+//                the file delta, then the offset and the line relative to the previous posting of the same file
+//                (absolute for the first posting in a file)
+// A lookup maps the index and reads only the entries it needs, nothing is loaded or lexed.
+
+const char TOKEN_INDEX_MAGIC[8] = {'P', 'H', 'P', 'L', 'X', 'I', 'D', 'X'};
+const uint32_t TOKEN_INDEX_VERSION = 1;
+
+struct TokenIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t fileCount;
+    uint64_t termCount;
+    uint64_t filesOffset;
+    uint64_t termsOffset;
+    uint64_t stringsOffset;
+    uint64_t postingsOffset;
+    uint64_t size; // Of the whole index, so a truncated one is rejected
+};
+
+struct TokenIndexFile {
+    static const uint32_t LEXER_ERROR = 1; // Tokens after the error aren't indexed
+    static const uint32_t UNREADABLE = 2;
+
+    uint64_t pathOffset;
+    uint32_t pathLength;
+    uint32_t flags;
+    int64_t modifiedNs; // Modification time and size of the file when it was lexed
+    uint64_t size;
+};
+
+struct TokenIndexTerm {
+    uint64_t valueOffset;
+    uint64_t postingsOffset; // From the start of the postings section
+    uint64_t postingsLength;
+    uint32_t valueLength;
+    uint32_t postingCount;
+};
+
+static_assert(sizeof(TokenIndexHeader) == 64 && sizeof(TokenIndexFile) == 32 && sizeof(TokenIndexTerm) == 32,
+    "Index entries are mapped directly, they must have no padding");
+
+inline void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+// Reads the varint at pos moving pos after it, returns false if it's cut by the end
+inline bool readVarint(const unsigned char*& pos, const unsigned char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+        unsigned char byte = *pos++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Read-only view of the index file mapped into memory. Entries are checked when they are read,
+// so a broken index gives empty values and failed posting lists instead of reads outside the mapping
+class MappedTokenIndex
+{
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    const TokenIndexHeader* header = nullptr;
+    const TokenIndexFile* files = nullptr;
+    const TokenIndexTerm* terms = nullptr;
+
+    std::string_view stringAt(uint64_t offset, uint64_t length) const {
+        uint64_t sectionSize = header->postingsOffset - header->stringsOffset;
+        if (offset > sectionSize || length > sectionSize - offset) {
+            return std::string_view();
+        }
+        return std::string_view(data + header->stringsOffset + offset, length);
+    }
+
+    bool isLayoutValid() const {
+        if (size < sizeof(TokenIndexHeader) || memcmp(header->magic, TOKEN_INDEX_MAGIC, sizeof(TOKEN_INDEX_MAGIC)) != 0
+            || header->version != TOKEN_INDEX_VERSION || header->size != size) {
+            return false;
+        }
+        bool isAligned = header->filesOffset % 8 == 0 && header->termsOffset % 8 == 0;
+        // Offsets and counts are bounded by the size first, so the sums below can't overflow
+        return isAligned && header->termCount <= size / sizeof(TokenIndexTerm)
+            && header->filesOffset >= sizeof(TokenIndexHeader) && header->filesOffset <= size
+            && header->filesOffset + header->fileCount * sizeof(TokenIndexFile) <= header->termsOffset
+            && header->termsOffset <= size && header->termCount * sizeof(TokenIndexTerm) <= size - header->termsOffset
+            && header->termsOffset + header->termCount * sizeof(TokenIndexTerm) <= header->stringsOffset
+            && header->stringsOffset <= header->postingsOffset && header->postingsOffset <= size;
+    }
+
+public:
+    MappedTokenIndex() = default;
+    MappedTokenIndex(const MappedTokenIndex&) = delete;
+    MappedTokenIndex& operator=(const MappedTokenIndex&) = delete;
+
+    ~MappedTokenIndex() {
+        close();
+    }
+
+    // Maps the index, returns false if there is no file or it isn't a valid index
+    bool open(const std::string& path) {
+
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) < 0 || static_cast<size_t>(fileStat.st_size) < sizeof(TokenIndexHeader)) {
+            ::close(fd);
+            return false;
+        }
+
+        size = fileStat.st_size;
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            size = 0;
+            return false;
+        }
+
+        data = static_cast<const char*>(mapping);
+        header = reinterpret_cast<const TokenIndexHeader*>(data);
+        if (!isLayoutValid()) {
+            close();
+            return false;
+        }
+        files = reinterpret_cast<const TokenIndexFile*>(data + header->filesOffset);
+        terms = reinterpret_cast<const TokenIndexTerm*>(data + header->termsOffset);
+        return true;
+    }
+
+    void close() {
+        if (data != nullptr) {
+            munmap(const_cast<char*>(data), size);
+        }
+        data = nullptr;
+        size = 0;
+        header = nullptr;
+        files = nullptr;
+        terms = nullptr;
+    }
+
+    size_t getSize() const {
+        return size;
+    }
+
+    size_t getFileCount() const {
+        return header != nullptr ? header->fileCount : 0;
+    }
+
+    const TokenIndexFile& getFile(size_t file) const {
+        return files[file];
+    }
+
+    std::string_view getPath(size_t file) const {
+        return stringAt(files[file].pathOffset, files[file].pathLength);
+    }
+
+    size_t getTermCount() const {
+        return header != nullptr ? header->termCount : 0;
+    }
+
+    std::string_view getTermValue(size_t term) const {
+        return stringAt(terms[term].valueOffset, terms[term].valueLength);
+    }
+
+    // Index of the first term with the value not less than the given one
+    size_t lowerBound(std::string_view value) const {
+        size_t low = 0;
+        size_t high = getTermCount();
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (getTermValue(middle) < value) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    // Calls visitor(file, offset, line) for every posting of the term in order, returns false if the postings are broken
+    template <typename Visitor>
+    bool forEachPosting(size_t term, Visitor visitor) const {
+
+        const TokenIndexTerm& entry = terms[term];
+        uint64_t sectionSize = size - header->postingsOffset;
+        if (entry.postingsOffset > sectionSize || entry.postingsLength > sectionSize - entry.postingsOffset) {
+            return false;
+        }
+        const unsigned char* pos = reinterpret_cast<const unsigned char*>(data + header->postingsOffset + entry.postingsOffset);
+        const unsigned char* end = pos + entry.postingsLength;
+
+        uint64_t file = 0;
+        uint64_t offset = 0;
+        uint64_t line = 0;
+        for (uint32_t i = 0; i < entry.postingCount; i++) {
+            uint64_t fileDelta, offsetDelta, lineDelta;
+            if (!readVarint(pos, end, fileDelta) || !readVarint(pos, end, offsetDelta) || !readVarint(pos, end, lineDelta)) {
+                return false;
+            }
+            if (fileDelta != 0 || i == 0) {
+                offset = 0;
+                line = 0;
+            }
+            file += fileDelta;
+            offset += offsetDelta;
+            line += lineDelta;
+            if (file >= header->fileCount) {
+                return false;
+            }
+            visitor(static_cast<uint32_t>(file), offset, line);
+        }
+        return true;
+    }
+};
+
+// Builds the index of a directory, or brings the existing one up to date
+class TokenIndexBuilder
+{
+public:
+    struct Stats {
+        size_t files = 0;
+        size_t lexedFiles = 0;
+        size_t unchangedFiles = 0;
+        size_t errorFiles = 0;
+        size_t terms = 0;
+        size_t postings = 0;
+        size_t bytes = 0;
+        bool isWritten = false; // False if nothing changed since the existing index
+    };
+
+private:
+    struct Posting {
+        uint32_t file;
+        uint32_t offset;
+        uint32_t line;
+    };
+
+    struct FileState {
+        std::string path;
+        int64_t modifiedNs;
+        uint64_t size;
+        uint32_t flags;
+    };
+
+    // Interned values with their postings, one table per lexer thread
+    struct TermTable {
+        std::deque<std::string> values; // A deque never moves its strings, so the keys of ids stay valid
+        std::unordered_map<std::string_view, uint32_t> ids;
+        std::vector<std::vector<Posting>> postings;
+
+        std::vector<Posting>& postingsOf(std::string_view value) {
+            auto it = ids.find(value);
+            if (it != ids.end()) {
+                return postings[it->second];
+            }
+            values.emplace_back(value);
+            ids.emplace(values.back(), static_cast<uint32_t>(postings.size()));
+            postings.emplace_back();
+            return postings.back();
+        }
+    };
+
+    // Adds postings of the identifiers and keywords of one file to the table
+    class PostingSink: public TokenSink {
+    public:
+        TermTable* table;
+        const char* sourceStart;
+        const char* counted; // Lines are counted up to here
+        uint32_t file;
+        uint32_t line;
+
+        void onToken(const TokenView& token) override {
+            if (token.type != TokenType::IDENTIFIER && token.type != TokenType::KEYWORD) {
+                return;
+            }
+            line += std::count(counted, token.value.data(), '\n');
+            counted = token.value.data();
+            uint32_t offset = static_cast<uint32_t>(token.value.data() - sourceStart);
+            table->postingsOf(token.value).push_back(Posting{file, offset, line});
+        }
+    };
+
+    static bool statFile(const std::string& path, FileState& state) {
+        struct stat fileStat;
+        if (stat(path.c_str(), &fileStat) < 0) {
+            return false;
+        }
+        state.path = path;
+        state.modifiedNs = static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+        state.size = fileStat.st_size;
+        state.flags = 0;
+        return true;
+    }
+
+    static bool writeIndex(const std::string& indexPath, const std::vector<FileState>& files, TermTable& table, Stats& stats) {
+
+        std::vector<uint32_t> order;
+        for (uint32_t i = 0; i < table.postings.size(); i++) {
+            if (!table.postings[i].empty()) {
+                order.push_back(i);
+            }
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return table.values[a] < table.values[b]; });
+
+        std::string strings;
+        std::vector<TokenIndexFile> fileEntries(files.size());
+        for (size_t i = 0; i < files.size(); i++) {
+            fileEntries[i] = TokenIndexFile{strings.length(), static_cast<uint32_t>(files[i].path.length()),
+                files[i].flags, files[i].modifiedNs, files[i].size};
+            strings += files[i].path;
+        }
+
+        std::string postingBytes;
+        std::vector<TokenIndexTerm> termEntries(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+
+            std::vector<Posting>& postings = table.postings[order[i]];
+            std::sort(postings.begin(), postings.end(), [](const Posting& a, const Posting& b) {
+                return a.file != b.file ? a.file < b.file : a.offset < b.offset;
+            });
+
+            size_t postingsStart = postingBytes.length();
+            Posting previous = {0, 0, 0};
+            for (size_t j = 0; j < postings.size(); j++) {
+                if (postings[j].file != previous.file || j == 0) {
+                    previous.offset = 0;
+                    previous.line = 0;
+                }
+                appendVarint(postingBytes, postings[j].file - previous.file);
+                appendVarint(postingBytes, postings[j].offset - previous.offset);
+                appendVarint(postingBytes, postings[j].line - previous.line);
+                previous = postings[j];
+            }
+
+            const std::string& value = table.values[order[i]];
+            termEntries[i] = TokenIndexTerm{strings.length(), postingsStart, postingBytes.length() - postingsStart,
+                static_cast<uint32_t>(value.length()), static_cast<uint32_t>(postings.size())};
+            strings += value;
+            stats.postings += postings.size();
+        }
+
+        TokenIndexHeader header = {};
+        memcpy(header.magic, TOKEN_INDEX_MAGIC, sizeof(header.magic));
+        header.version = TOKEN_INDEX_VERSION;
+        header.fileCount = static_cast<uint32_t>(files.size());
+        header.termCount = termEntries.size();
+        header.filesOffset = sizeof(TokenIndexHeader);
+        header.termsOffset = header.filesOffset + fileEntries.size() * sizeof(TokenIndexFile);
+        header.stringsOffset = header.termsOffset + termEntries.size() * sizeof(TokenIndexTerm);
+        header.postingsOffset = (header.stringsOffset + strings.length() + 7) / 8 * 8;
+        header.size = header.postingsOffset + postingBytes.length();
+        strings.resize(header.postingsOffset - header.stringsOffset, '\0');
+
+        // Written next to the index and renamed over it, so the index is never seen half written
+        std::string temporaryPath = indexPath + ".tmp";
+        FILE* out = fopen(temporaryPath.c_str(), "wb");
+        if (out == nullptr) {
+            perror(temporaryPath.c_str());
+            return false;
+        }
+        fwrite(&header, sizeof(header), 1, out);
+        fwrite(fileEntries.data(), sizeof(TokenIndexFile), fileEntries.size(), out);
+        fwrite(termEntries.data(), sizeof(TokenIndexTerm), termEntries.size(), out);
+        fwrite(strings.data(), 1, strings.length(), out);
+        fwrite(postingBytes.data(), 1, postingBytes.length(), out);
+        bool isWritten = !ferror(out);
+        isWritten = fclose(out) == 0 && isWritten;
+        if (!isWritten || rename(temporaryPath.c_str(), indexPath.c_str()) < 0) {
+            perror(indexPath.c_str());
+            unlink(temporaryPath.c_str());
+            return false;
+        }
+
+        stats.terms = termEntries.size();
+        stats.bytes = header.size;
+        stats.isWritten = true;
+        return true;
+    }
+
+public:
+
+    // Indexes the .php files of the directory into the index file. If the index file is a valid index,
+    // only the files changed since it was built are lexed. Returns false if the index can't be written
+    bool build(const std::string& directory, const std::string& indexPath, Stats& stats) {
+
+        stats = Stats();
+        std::vector<FileState> files;
+        for (const auto& path : collectPhpFiles(directory)) {
+            FileState state;
+            if (statFile(path, state)) {
+                files.push_back(std::move(state));
+            }
+        }
+
+        // Files unchanged since the previous index keep their postings, the rest are lexed
+        MappedTokenIndex previous;
+        bool hasPrevious = previous.open(indexPath);
+        std::unordered_map<std::string_view, uint32_t> previousIds;
+        for (size_t i = 0; i < previous.getFileCount(); i++) {
+            previousIds.emplace(previous.getPath(i), static_cast<uint32_t>(i));
+        }
+
+        std::vector<int64_t> newIds(previous.getFileCount(), -1); // Of the previous files still valid
+        std::vector<std::string> lexedPaths;
+        std::vector<uint32_t> lexedIds;
+        for (uint32_t i = 0; i < files.size(); i++) {
+            auto it = previousIds.find(files[i].path);
+            const TokenIndexFile* entry = it != previousIds.end() ? &previous.getFile(it->second) : nullptr;
+            if (entry != nullptr && entry->modifiedNs == files[i].modifiedNs && entry->size == files[i].size
+                && (entry->flags & TokenIndexFile::UNREADABLE) == 0) {
+                newIds[it->second] = i;
+                files[i].flags = entry->flags;
+                stats.unchangedFiles++;
+            } else {
+                lexedPaths.push_back(files[i].path);
+                lexedIds.push_back(i);
+            }
+        }
+
+        stats.files = files.size();
+        auto countErrorFiles = [&]() {
+            for (const auto& file : files) {
+                stats.errorFiles += file.flags != 0 ? 1 : 0;
+            }
+        };
+        if (hasPrevious && lexedPaths.empty() && files.size() == previous.getFileCount()) {
+            countErrorFiles();
+            stats.terms = previous.getTermCount();
+            stats.bytes = previous.getSize();
+            return true; // Nothing changed
+        }
+
+        LexerPipeline pipeline;
+        std::vector<PHPLexer> lexers(pipeline.getLexerThreads());
+        std::vector<TermTable> tables(pipeline.getLexerThreads());
+
+        pipeline.run(lexedPaths,
+            [&](size_t lexerIndex, size_t fileIndex, std::string_view sourceCode) {
+                FileState& file = files[lexedIds[fileIndex]];
+                if (sourceCode.length() > UINT32_MAX) {
+                    file.flags = TokenIndexFile::LEXER_ERROR; // Offsets of postings are 32-bit
+                    return;
+                }
+                PostingSink sink;
+                sink.table = &tables[lexerIndex];
+                sink.sourceStart = sourceCode.data();
+                sink.counted = sourceCode.data();
+                sink.file = lexedIds[fileIndex];
+                sink.line = 1;
+                try {
+                    lexers[lexerIndex].setSourceView(sourceCode);
+                    lexers[lexerIndex].getTokens(sink);
+                } catch (const LexerException& e) {
+                    file.flags = TokenIndexFile::LEXER_ERROR;
+                }
+            },
+            [&](size_t, size_t fileIndex) {
+                // Lexed again by the next update, as the modification time never matches
+                FileState& file = files[lexedIds[fileIndex]];
+                file.flags = TokenIndexFile::UNREADABLE;
+                file.modifiedNs = 0;
+            });
+        stats.lexedFiles = lexedPaths.size();
+
+        // Postings of the unchanged files, then of the lexed ones, all in one table
+        TermTable merged;
+        for (size_t term = 0; term < previous.getTermCount(); term++) {
+            std::vector<Posting>* postings = nullptr;
+            bool isValid = previous.forEachPosting(term, [&](uint32_t file, uint64_t offset, uint64_t line) {
+                if (newIds[file] >= 0) {
+                    if (postings == nullptr) {
+                        postings = &merged.postingsOf(previous.getTermValue(term));
+                    }
+                    postings->push_back(Posting{static_cast<uint32_t>(newIds[file]), static_cast<uint32_t>(offset),
+                        static_cast<uint32_t>(line)});
+                }
+            });
+            if (!isValid) {
+                fprintf(stderr, "The index %s is broken, rebuild it from scratch\n", indexPath.c_str());
+                return false;
+            }
+        }
+        for (auto& table : tables) {
+            for (size_t i = 0; i < table.postings.size(); i++) {
+                std::vector<Posting>& postings = merged.postingsOf(table.values[i]);
+                if (postings.empty()) {
+                    postings = std::move(table.postings[i]);
+                } else {
+                    postings.insert(postings.end(), table.postings[i].begin(), table.postings[i].end());
+                }
+            }
+        }
+
+        countErrorFiles();
+        previous.close(); // Values are copied into the merged table, the old index may be replaced
+        return writeIndex(indexPath, files, merged, stats);
+    }
+};
+
+#endif
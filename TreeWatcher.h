@@ -0,0 +1,562 @@
+#ifndef TREE_WATCHER_H
+#define TREE_WATCHER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <memory>
+#include <shared_mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "PHPLexer.h"
+#include "JsonUtils.h"
+#include "LexerServer.h"
+#include "LexerPipeline.h"
+#include "TokenFinder.h"
+
+// Keeps tokens of all .php files of a directory in memory and up to date, used by the --watch mode.
+// The whole tree is lexed once in parallel, then inotify reports changed files and only they are lexed again,
+// so an update costs as much as the change, not as the tree.
+// Events come in bursts (an editor saving, a checkout, a build): changed paths are collected into a set
+// and lexed together once the tree is quiet for DEBOUNCE_MS (or after MAX_DELAY_MS of constant changes).
+//
+// Queries are lines of text, the reply to each is a line of JSON:
+//     stats                      - {"files":N,"tokens":N,"bytes":N,"errors":N,"updates":N,"lastUpdateFiles":N,"lastUpdateMs":X}
+//     files                      - {"files":[{"path":"...","tokens":N},{"path":"...","error":"..."},...]}
+//     tokens <path>              - {"tokens":[{"type":"IDENTIFIER","value":"$a","line":1},...]} or {"error":"..."}
+//     find <type>:<value>[*]...  - {"hits":[{"path":"...","line":N,"value":"..."},...]}
+// Paths are the ones listed by "files". Files are replaced as a whole, so a query sees every file
+// either before or after its update while updates go on concurrently.
+class TreeWatcher
+{
+private:
+    // One version of the file, the token values point into its code
+    struct IndexedFile {
+        std::string code;
+        std::vector<TokenView> tokens;
+        std::string error; // Lexer error, there are no tokens then
+    };
+    // Ordered by path, so files of a removed directory are a single range
+    using FileMap = std::map<std::string, std::shared_ptr<const IndexedFile>>;
+
+    static constexpr int DEBOUNCE_MS = 50;
+    static constexpr int MAX_DELAY_MS = 500;
+    // How often the event loop checks if it's stopped
+    static constexpr int POLL_MS = 100;
+    static constexpr uint32_t EVENT_MASK = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR;
+
+    std::string root;
+    mutable std::shared_mutex filesMutex;
+    FileMap files;
+
+    // Used only by the event thread (and by start() before it runs)
+    int inotifyFd = -1;
+    std::unordered_map<int, std::string> watchedDirectories; // Watch descriptor -> directory path
+    std::set<std::string> changedPaths; // .php files created, written, moved or deleted since the last update
+    std::set<std::string> removedDirectories;
+    bool isRescanNeeded = false; // Events were lost because the inotify queue overflowed
+
+    std::thread eventThread;
+    std::atomic<bool> isStopped{false};
+    std::atomic<uint64_t> updates{0};
+    std::atomic<uint64_t> lastUpdateFiles{0};
+    std::atomic<double> lastUpdateMs{0};
+
+    static bool isPhpPath(const std::string& path) {
+        return path.length() > 4 && path.compare(path.length() - 4, 4, ".php") == 0;
+    }
+
+    static std::shared_ptr<const IndexedFile> lexFile(PHPLexer& lexer, std::string_view sourceCode) {
+        auto file = std::make_shared<IndexedFile>();
+        file->code.assign(sourceCode.data(), sourceCode.length());
+        try {
+            lexer.setSourceView(file->code);
+            lexer.getTokens(file->tokens);
+            file->tokens.shrink_to_fit(); // Kept for long, so the growth slack isn't
+        } catch (const LexerException& e) {
+            file->tokens = std::vector<TokenView>();
+            file->error = e.what();
+        }
+        return file;
+    }
+
+    // Lexes the files in parallel and puts them into the index, files that can't be read are removed from it
+    void lexFiles(const std::vector<std::string>& paths) {
+
+        if (paths.empty()) {
+            return;
+        }
+
+        // Small updates don't start more threads than files
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        LexerPipeline pipeline(std::min(paths.size(), cores), std::min(paths.size(), size_t(4)));
+        std::vector<PHPLexer> lexers(pipeline.getLexerThreads());
+        std::vector<std::shared_ptr<const IndexedFile>> lexed(paths.size());
+
+        pipeline.run(paths,
+            [&](size_t lexerIndex, size_t fileIndex, std::string_view sourceCode) {
+                lexed[fileIndex] = lexFile(lexers[lexerIndex], sourceCode);
+            },
+            [&](size_t, size_t) {
+                // Deleted or moved away, stays null
+            });
+
+        std::unique_lock<std::shared_mutex> lock(filesMutex);
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (lexed[i] != nullptr) {
+                files[paths[i]] = std::move(lexed[i]);
+            } else {
+                files.erase(paths[i]);
+            }
+        }
+    }
+
+    void addWatch(const std::string& directory) {
+        int wd = inotify_add_watch(inotifyFd, directory.c_str(), EVENT_MASK);
+        if (wd >= 0) {
+            watchedDirectories[wd] = directory;
+        }
+    }
+
+    // Watches the directory and all its subdirectories (not following symlinks, as collectPhpFiles does)
+    void watchTree(const std::string& directory) {
+
+        addWatch(directory);
+
+        std::error_code error;
+        auto options = std::filesystem::directory_options::skip_permission_denied;
+        for (auto it = std::filesystem::recursive_directory_iterator(directory, options, error);
+             it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+
+            if (error) {
+                break;
+            }
+            if (it->is_directory(error) && !it->is_symlink(error)) {
+                addWatch(it->path().string());
+            }
+        }
+    }
+
+    // Stops watching the directory moved away or deleted, and its subdirectories
+    void unwatchTree(const std::string& directory) {
+        std::string prefix = directory + "/";
+        for (auto it = watchedDirectories.begin(); it != watchedDirectories.end();) {
+            if (it->second == directory || it->second.compare(0, prefix.length(), prefix) == 0) {
+                inotify_rm_watch(inotifyFd, it->first);
+                it = watchedDirectories.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Records the change reported by the event, returns false if the event doesn't change the index
+    bool handleEvent(const inotify_event& event) {
+
+        if (event.mask & IN_Q_OVERFLOW) {
+            isRescanNeeded = true;
+            return true;
+        }
+        if (event.mask & IN_IGNORED) {
+            watchedDirectories.erase(event.wd);
+            return false;
+        }
+
+        auto directory = watchedDirectories.find(event.wd);
+        if (directory == watchedDirectories.end() || event.len == 0) {
+            return false;
+        }
+        std::string path = directory->second + "/" + event.name;
+
+        if (event.mask & IN_ISDIR) {
+            if (event.mask & (IN_CREATE | IN_MOVED_TO)) {
+                // Files may be put into it before it's watched, so they are looked for too
+                watchTree(path);
+                for (auto& file : collectPhpFiles(path)) {
+                    changedPaths.insert(std::move(file));
+                }
+                return true;
+            }
+            if (event.mask & (IN_DELETE | IN_MOVED_FROM)) {
+                unwatchTree(path);
+                removedDirectories.insert(path);
+                return true;
+            }
+            return false;
+        }
+
+        if (!isPhpPath(path)) {
+            return false;
+        }
+        changedPaths.insert(path);
+        return true;
+    }
+
+    // Reads all the events queued, returns true if any of them changes the index
+    bool readEvents() {
+
+        alignas(inotify_event) char buffer[64 * 1024];
+        bool isChanged = false;
+
+        while (true) {
+            ssize_t n = read(inotifyFd, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break; // EAGAIN, nothing more queued
+            }
+            for (char* p = buffer; p < buffer + n;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                isChanged = handleEvent(*event) || isChanged;
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+        return isChanged;
+    }
+
+    // Brings the index up to date with the changes collected
+    void applyChanges() {
+
+        auto start = std::chrono::steady_clock::now();
+
+        if (isRescanNeeded) {
+            // Anything may have changed: every file found is lexed, every file indexed is checked
+            watchTree(root);
+            for (auto& file : collectPhpFiles(root)) {
+                changedPaths.insert(std::move(file));
+            }
+            std::shared_lock<std::shared_mutex> lock(filesMutex);
+            for (const auto& file : files) {
+                changedPaths.insert(file.first);
+            }
+            isRescanNeeded = false;
+        }
+
+        if (!removedDirectories.empty()) {
+            std::unique_lock<std::shared_mutex> lock(filesMutex);
+            for (const auto& directory : removedDirectories) {
+                std::string prefix = directory + "/";
+                auto first = files.lower_bound(prefix);
+                auto last = first;
+                while (last != files.end() && last->first.compare(0, prefix.length(), prefix) == 0) {
+                    ++last;
+                }
+                files.erase(first, last);
+            }
+        }
+
+        // Files of a removed directory queued before its removal can't be read now, so they are just dropped
+        std::vector<std::string> paths(changedPaths.begin(), changedPaths.end());
+        lexFiles(paths);
+
+        lastUpdateFiles = paths.size();
+        lastUpdateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        updates++;
+
+        changedPaths.clear();
+        removedDirectories.clear();
+    }
+
+    void runEventLoop() {
+
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point firstChange;
+        Clock::time_point lastChange;
+        bool isPending = false;
+
+        while (!isStopped) {
+
+            int timeout = POLL_MS;
+            if (isPending) {
+                auto deadline = std::min(lastChange + std::chrono::milliseconds(DEBOUNCE_MS),
+                    firstChange + std::chrono::milliseconds(MAX_DELAY_MS));
+                auto now = Clock::now();
+                if (now >= deadline) {
+                    applyChanges();
+                    isPending = false;
+                    continue;
+                }
+                timeout = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+            }
+
+            pollfd pollFd = {inotifyFd, POLLIN, 0};
+            if (poll(&pollFd, 1, timeout) > 0 && (pollFd.revents & POLLIN) && readEvents()) {
+                lastChange = Clock::now();
+                if (!isPending) {
+                    firstChange = lastChange;
+                    isPending = true;
+                }
+            }
+        }
+    }
+
+    // Copy of the index at the moment, files in it stay alive while the copy is used
+    FileMap snapshot() const {
+        std::shared_lock<std::shared_mutex> lock(filesMutex);
+        return files;
+    }
+
+    std::shared_ptr<const IndexedFile> findFile(const std::string& path) const {
+        std::shared_lock<std::shared_mutex> lock(filesMutex);
+        auto it = files.find(path);
+        if (it == files.end()) {
+            it = files.find(std::filesystem::path(path).lexically_normal().string());
+        }
+        return it != files.end() ? it->second : nullptr;
+    }
+
+    std::string queryStats() const {
+
+        size_t fileCount = 0;
+        size_t tokenCount = 0;
+        size_t byteCount = 0;
+        size_t errorCount = 0;
+        {
+            // Counted under the lock instead of copying the whole map
+            std::shared_lock<std::shared_mutex> lock(filesMutex);
+            fileCount = files.size();
+            for (const auto& file : files) {
+                tokenCount += file.second->tokens.size();
+                byteCount += file.second->code.length();
+                errorCount += file.second->error.empty() ? 0 : 1;
+            }
+        }
+
+        char updateMs[32];
+        snprintf(updateMs, sizeof(updateMs), "%.3f", lastUpdateMs.load());
+        return "{\"files\":" + std::to_string(fileCount) + ",\"tokens\":" + std::to_string(tokenCount)
+            + ",\"bytes\":" + std::to_string(byteCount) + ",\"errors\":" + std::to_string(errorCount)
+            + ",\"updates\":" + std::to_string(updates.load()) + ",\"lastUpdateFiles\":" + std::to_string(lastUpdateFiles.load())
+            + ",\"lastUpdateMs\":" + updateMs + "}";
+    }
+
+    std::string queryFiles() const {
+        std::string reply = "{\"files\":[";
+        FileMap current = snapshot();
+        for (auto it = current.begin(); it != current.end(); ++it) {
+            reply += it == current.begin() ? "{\"path\":" : ",{\"path\":";
+            appendJsonString(reply, it->first);
+            if (it->second->error.empty()) {
+                reply += ",\"tokens\":" + std::to_string(it->second->tokens.size()) + "}";
+            } else {
+                reply += ",\"error\":";
+                appendJsonString(reply, it->second->error);
+                reply += "}";
+            }
+        }
+        reply += "]}";
+        return reply;
+    }
+
+    std::string queryTokens(const std::string& path) const {
+
+        std::shared_ptr<const IndexedFile> file = findFile(path);
+        std::string reply;
+        if (file == nullptr || !file->error.empty()) {
+            reply = "{\"error\":";
+            appendJsonString(reply, file == nullptr ? "Not indexed: " + path : file->error);
+            reply += "}";
+            return reply;
+        }
+
+        reply = "{\"tokens\":[";
+        size_t line = 1;
+        const char* counted = file->code.data();
+        for (size_t i = 0; i < file->tokens.size(); i++) {
+            const TokenView& token = file->tokens[i];
+            line += std::count(counted, token.value.data(), '\n');
+            counted = token.value.data();
+            reply += i == 0 ? "{\"type\":\"" : ",{\"type\":\"";
+            reply += tokenTypeName(token.type);
+            reply += "\",\"value\":";
+            appendJsonString(reply, token.value);
+            reply += ",\"line\":" + std::to_string(line) + "}";
+        }
+        reply += "]}";
+        return reply;
+    }
+
+    std::string queryHits(const std::vector<std::string>& predicateTexts) const {
+
+        std::vector<TokenPredicate> predicates(predicateTexts.size());
+        for (size_t i = 0; i < predicateTexts.size(); i++) {
+            if (!parseTokenPredicate(predicateTexts[i], predicates[i])) {
+                std::string reply = "{\"error\":";
+                appendJsonString(reply, "Wrong predicate: " + predicateTexts[i]);
+                return reply + "}";
+            }
+        }
+
+        std::string reply = "{\"hits\":[";
+        bool isFirst = true;
+        FileMap current = snapshot();
+        for (const auto& file : current) {
+            size_t line = 1;
+            const char* counted = file.second->code.data();
+            for (const auto& token : file.second->tokens) {
+                bool isMatched = std::any_of(predicates.begin(), predicates.end(),
+                    [&](const TokenPredicate& predicate) { return predicate.matches(token); });
+                if (!isMatched) {
+                    continue;
+                }
+                line += std::count(counted, token.value.data(), '\n');
+                counted = token.value.data();
+                reply += isFirst ? "{\"path\":" : ",{\"path\":";
+                appendJsonString(reply, file.first);
+                reply += ",\"line\":" + std::to_string(line) + ",\"value\":";
+                appendJsonString(reply, token.value);
+                reply += "}";
+                isFirst = false;
+            }
+        }
+        reply += "]}";
+        return reply;
+    }
+
+public:
+
+    explicit TreeWatcher(const std::string& directory) : root(directory) {
+        // Paths of events are built as <directory>/<name>, they must look like the ones of collectPhpFiles
+        while (root.length() > 1 && root.back() == '/') {
+            root.pop_back();
+        }
+    }
+
+    ~TreeWatcher() {
+        stop();
+        if (inotifyFd >= 0) {
+            close(inotifyFd);
+        }
+    }
+
+    // Starts watching the tree, lexes all its files and starts the updates.
+    // Returns false if inotify can't be used
+    bool start() {
+
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0) {
+            perror("inotify_init1");
+            return false;
+        }
+
+        // Watching before lexing: files changed meanwhile are lexed once more by the first update
+        auto startTime = std::chrono::steady_clock::now();
+        watchTree(root);
+        std::vector<std::string> paths = collectPhpFiles(root);
+        lexFiles(paths);
+        lastUpdateFiles = paths.size();
+        lastUpdateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+        eventThread = std::thread(&TreeWatcher::runEventLoop, this);
+        return true;
+    }
+
+    void stop() {
+        isStopped = true;
+        if (eventThread.joinable()) {
+            eventThread.join();
+        }
+    }
+
+    // Reply to the query line (without the new line)
+    std::string query(const std::string& line) const {
+
+        size_t space = line.find(' ');
+        std::string command = line.substr(0, space);
+        std::string argument = space == std::string::npos ? "" : line.substr(space + 1);
+
+        if (command == "stats" && argument.empty()) {
+            return queryStats();
+        }
+        if (command == "files" && argument.empty()) {
+            return queryFiles();
+        }
+        if (command == "tokens" && !argument.empty()) {
+            return queryTokens(argument);
+        }
+        if (command == "find" && !argument.empty()) {
+            std::vector<std::string> predicateTexts;
+            size_t start = 0;
+            while (start < argument.length()) {
+                size_t end = std::min(argument.find(' ', start), argument.length());
+                if (end > start) {
+                    predicateTexts.push_back(argument.substr(start, end - start));
+                }
+                start = end + 1;
+            }
+            return queryHits(predicateTexts);
+        }
+
+        std::string reply = "{\"error\":";
+        appendJsonString(reply, "Unknown query: " + line);
+        return reply + "}";
+    }
+
+    // Answers query lines read from inFd until its end, replies are written to outFd
+    void serveQueries(int inFd, int outFd) const {
+
+        std::string pending;
+        char buffer[4096];
+
+        while (true) {
+            ssize_t n = read(inFd, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return;
+            }
+            pending.append(buffer, n);
+
+            size_t lineStart = 0;
+            size_t lineEnd;
+            while ((lineEnd = pending.find('\n', lineStart)) != std::string::npos) {
+                std::string line = pending.substr(lineStart, lineEnd - lineStart);
+                lineStart = lineEnd + 1;
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (line.empty()) {
+                    continue;
+                }
+                std::string reply = query(line) + "\n";
+                if (!writeAll(outFd, reply.data(), reply.length())) {
+                    return;
+                }
+            }
+            pending.erase(0, lineStart);
+        }
+    }
+
+    // Listens on the unix domain socket, queries of each connection are answered in its own thread
+    // (up to MAX_CONNECTIONS at once, as LexerServer does)
+    int serveSocket(const std::string& socketPath) const {
+
+        int listenFd = listenUnixSocket(socketPath);
+        if (listenFd < 0) {
+            return 1;
+        }
+
+        acceptConnections(listenFd, MAX_CONNECTIONS, [this](int fd) {
+            serveQueries(fd, fd);
+            close(fd);
+        });
+
+        close(listenFd);
+        return 1;
+    }
+};
+
+#endif
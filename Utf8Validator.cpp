@@ -0,0 +1,89 @@
+#include "Utf8Validator.h"
+#include <cstdint>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+bool validateUtf8(std::string_view text, std::vector<size_t>& invalidOffsets) {
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text.data());
+    size_t length = text.length();
+    size_t pos = 0;
+    bool isValid = true;
+
+    while (pos < length) {
+
+        // --- ASCII fast path ---
+#ifdef __SSE2__
+        while (pos + 16 <= length) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + pos));
+            if (_mm_movemask_epi8(chunk) != 0) {
+                break; // Some byte has the high bit set
+            }
+            pos += 16;
+        }
+#endif
+        while (pos + 8 <= length) {
+            uint64_t chunk;
+            memcpy(&chunk, bytes + pos, 8);
+            if ((chunk & 0x8080808080808080ULL) != 0) {
+                break;
+            }
+            pos += 8;
+        }
+        while (pos < length && bytes[pos] < 0x80) {
+            pos++;
+        }
+        if (pos >= length) {
+            break;
+        }
+
+        // --- Multi-byte sequence ---
+        unsigned char first = bytes[pos];
+        size_t sequenceLength;
+        // Allowed range of the second byte, it rules out overlong forms, surrogates and code points above U+10FFFF
+        unsigned char secondMin = 0x80;
+        unsigned char secondMax = 0xBF;
+
+        if (first >= 0xC2 && first <= 0xDF) {
+            sequenceLength = 2;
+        } else if (first >= 0xE0 && first <= 0xEF) {
+            sequenceLength = 3;
+            if (first == 0xE0) {
+                secondMin = 0xA0;
+            } else if (first == 0xED) {
+                secondMax = 0x9F;
+            }
+        } else if (first >= 0xF0 && first <= 0xF4) {
+            sequenceLength = 4;
+            if (first == 0xF0) {
+                secondMin = 0x90;
+            } else if (first == 0xF4) {
+                secondMax = 0x8F;
+            }
+        } else {
+            // Continuation byte without a start, or a byte never used in UTF-8
+            invalidOffsets.push_back(pos);
+            isValid = false;
+            pos++;
+            continue;
+        }
+
+        bool isSequenceValid = pos + sequenceLength <= length
+            && bytes[pos + 1] >= secondMin && bytes[pos + 1] <= secondMax;
+        for (size_t i = 2; isSequenceValid && i < sequenceLength; i++) {
+            isSequenceValid = (bytes[pos + i] & 0xC0) == 0x80;
+        }
+
+        if (isSequenceValid) {
+            pos += sequenceLength;
+        } else {
+            invalidOffsets.push_back(pos);
+            isValid = false;
+            pos++;
+        }
+    }
+
+    return isValid;
+}
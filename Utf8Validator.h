@@ -0,0 +1,15 @@
+#ifndef UTF8_VALIDATOR_H
+#define UTF8_VALIDATOR_H
+
+#include <string_view>
+#include <vector>
+
+// Validates UTF-8 encoding of the text.
+// Offsets of the bytes starting invalid sequences are added to invalidOffsets,
+// after an invalid byte the check goes on from the next byte.
+// ASCII is checked 16 bytes at once (SSE2) or 8 bytes at once otherwise,
+// only the chunks with non-ASCII bytes are decoded one by one.
+// Returns true if the text is valid
+bool validateUtf8(std::string_view text, std::vector<size_t>& invalidOffsets);
+
+#endif
@@ -0,0 +1,229 @@
+// This is an example to test all stuff
+if \"hello\" or (true >= false) do 
+    'how are you' && "looking good" 
+else 
+    NULL, $_my_var2::123 <=> 123. /* Just testing different stuff */ 45.67 > -0.89 ??;
+if($var1) else for while()
+"Hello" 'world'
+
+123 123.
+45.67 0.89
+true false
+NULL
+
+// Works with symbols before and after the literal
+-12
+(56+7.8)
+!true ~false
+true|(false)
+(NULL)
+
+
++ = * / % = += -= *= /= %= == === != !== < > <= >= <=> <> && || ! & | ^ ~ << >> .= . ? : ?? @ and or xor
+; , :: => -> ?-> ... [ ] { } ()
+// This is comment
+123 /* Opened and closed comment */ 321
+/* 
+Multy line comment.
+This code is still treated as a comment
+*/
+# This is also a comment
+456
+$var1 $_var2 $my_var $_
+// This is an example to test all stuff
+if \"hello\" or (true >= false) do 
+    'how are you' && "looking good" 
+else 
+    NULL, $_my_var2::123 <=> 123. /* Just testing different stuff */ 45.67 > -0.89 ??;
+if($var1) else for while()
+"Hello" 'world'
+
+123 123.
+45.67 0.89
+true false
+NULL
+
+// Works with symbols before and after the literal
+-12
+(56+7.8)
+!true ~false
+true|(false)
+(NULL)
+
+
++ = * / % = += -= *= /= %= == === != !== < > <= >= <=> <> && || ! & | ^ ~ << >> .= . ? : ?? @ and or xor
+; , :: => -> ?-> ... [ ] { } ()
+// This is comment
+123 /* Opened and closed comment */ 321
+/* 
+Multy line comment.
+This code is still treated as a comment
+*/
+# This is also a comment
+456
+$var1 $_var2 $my_var $_
+// This is an example to test all stuff
+if \"hello\" or (true >= false) do 
+    'how are you' && "looking good" 
+else 
+    NULL, $_my_var2::123 <=> 123. /* Just testing different stuff */ 45.67 > -0.89 ??;
+if($var1) else for while()
+"Hello" 'world'
+
+123 123.
+45.67 0.89
+true false
+NULL
+
+// Works with symbols before and after the literal
+-12
+(56+7.8)
+!true ~false
+true|(false)
+(NULL)
+
+
++ = * / % = += -= *= /= %= == === != !== < > <= >= <=> <> && || ! & | ^ ~ << >> .= . ? : ?? @ and or xor
+; , :: => -> ?-> ... [ ] { } ()
+// This is comment
+123 /* Opened and closed comment */ 321
+/* 
+Multy line comment.
+This code is still treated as a comment
+*/
+# This is also a comment
+456
+$var1 $_var2 $my_var $_
+// This is an example to test all stuff
+if \"hello\" or (true >= false) do 
+    'how are you' && "looking good" 
+else 
+    NULL, $_my_var2::123 <=> 123. /* Just testing different stuff */ 45.67 > -0.89 ??;
+if($var1) else for while()
+"Hello" 'world'
+
+123 123.
+45.67 0.89
+true false
+NULL
+
+// Works with symbols before and after the literal
+-12
+(56+7.8)
+!true ~false
+true|(false)
+(NULL)
+
+
++ = * / % = += -= *= /= %= == === != !== < > <= >= <=> <> && || ! & | ^ ~ << >> .= . ? : ?? @ and or xor
+; , :: => -> ?-> ... [ ] { } ()
+// This is comment
+123 /* Opened and closed comment */ 321
+/* 
+Multy line comment.
+This code is still treated as a comment
+*/
+# This is also a comment
+456
+$var1 $_var2 $my_var $_
+// This is an example to test all stuff
+if \"hello\" or (true >= false) do 
+    'how are you' && "looking good" 
+else 
+    NULL, $_my_var2::123 <=> 123. /* Just testing different stuff */ 45.67 > -0.89 ??;
+if($var1) else for while()
+"Hello" 'world'
+
+123 123.
+45.67 0.89
+true false
+NULL
+
+// Works with symbols before and after the literal
+-12
+(56+7.8)
+!true ~false
+true|(false)
+(NULL)
+
+
++ = * / % = += -= *= /= %= == === != !== < > <= >= <=> <> && || ! & | ^ ~ << >> .= . ? : ?? @ and or xor
+; , :: => -> ?-> ... [ ] { } ()
+// This is comment
+123 /* Opened and closed comment */ 321
+/* 
+Multy line comment.
+This code is still treated as a comment
+*/
+# This is also a comment
+456
+$var1 $_var2 $my_var $_
+// This is an example to test all stuff
+if \"hello\" or (true >= false) do 
+    'how are you' && "looking good" 
+else 
+    NULL, $_my_var2::123 <=> 123. /* Just testing different stuff */ 45.67 > -0.89 ??;
+if($var1) else for while()
+"Hello" 'world'
+
+123 123.
+45.67 0.89
+true false
+NULL
+
+// Works with symbols before and after the literal
+-12
+(56+7.8)
+!true ~false
+true|(false)
+(NULL)
+
+
++ = * / % = += -= *= /= %= == === != !== < > <= >= <=> <> && || ! & | ^ ~ << >> .= . ? : ?? @ and or xor
+; , :: => -> ?-> ... [ ] { } ()
+// This is comment
+123 /* Opened and closed comment */ 321
+/* 
+Multy line comment.
+This code is still treated as a comment
+*/
+# This is also a comment
+456
+$var1 $_var2 $my_var $_
+// This is an example to test all stuff
+if \"hello\" or (true >= false) do 
+    'how are you' && "looking good" 
+else 
+    NULL, $_my_var2::123 <=> 123. /* Just testing different stuff */ 45.67 > -0.89 ??;
+if($var1) else for while()
+"Hello" 'world'
+
+123 123.
+45.67 0.89
+true false
+NULL
+
+// Works with symbols before and after the literal
+-12
+(56+7.8)
+!true ~false
+true|(false)
+(NULL)
+
+
++ = * / % = += -= *= /= %= == === != !== < > <= >= <=> <> && || ! & | ^ ~ << >> .= . ? : ?? @ and or xor
+; , :: => -> ?-> ... [ ] { } ()
+// This is comment
+123 /* Opened and closed comment */ 321
+/* 
+Multy line comment.
+This code is still treated as a comment
+*/
+# This is also a comment
+456
+$var1 $_var2 $my_var $_
+// This is an example to test all stuff
+if \"hello\" or (true >= false) do 
+    'how are you' && "looking good" 
+else 
+    NULL, $_my_var2::123 <=> 123. /* Just testing different stuff */ 45.67 > -0.89 ??;
@@ -0,0 +1,184 @@
+#ifndef PHPLEXER_C_H
+#define PHPLEXER_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * C interface of the PHP lexer (libphplexer), usable from any language with a C FFI.
+ * Many inputs are lexed in one call, tokens are written into the caller's arena
+ * and point into the caller's input buffers, so nothing is copied or allocated for the caller.
+ * Functions are thread safe, each thread uses its own lexer.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Version of the ABI, changes when structures or functions change incompatibly.
+ * 2: the reserved field of phplexer_token became the subtype */
+#define PHPLEXER_ABI_VERSION 2
+
+/* Token types, the same values as TokenType of PHPLexer.h */
+enum {
+    PHPLEXER_TOKEN_COMMENT = 0,
+    PHPLEXER_TOKEN_KEYWORD = 1,
+    PHPLEXER_TOKEN_OPERATOR = 2,
+    PHPLEXER_TOKEN_IDENTIFIER = 3,
+    PHPLEXER_TOKEN_PUNCTUATION = 4,
+    PHPLEXER_TOKEN_INTEGER = 5,
+    PHPLEXER_TOKEN_FLOAT = 6,
+    PHPLEXER_TOKEN_STRING = 7,
+    PHPLEXER_TOKEN_BOOLEAN = 8,
+    PHPLEXER_TOKEN_NUL = 9,
+    PHPLEXER_TOKEN_END_OF_FILE = 10
+};
+
+/*
+ * Token subtypes, the same values as TokenSubtype of PHPLexer.h.
+ * The values are fixed: new subtypes get new numbers, the existing ones never change
+ */
+enum {
+    PHPLEXER_SUBTYPE_NONE = 0,
+
+    /* Keywords */
+    PHPLEXER_SUBTYPE_KEYWORD_IF = 1,                     /* if */
+    PHPLEXER_SUBTYPE_KEYWORD_ELSE = 2,                   /* else */
+    PHPLEXER_SUBTYPE_KEYWORD_DO = 3,                     /* do */
+    PHPLEXER_SUBTYPE_KEYWORD_WHILE = 4,                  /* while */
+    PHPLEXER_SUBTYPE_KEYWORD_FOR = 5,                    /* for */
+    PHPLEXER_SUBTYPE_KEYWORD_FOREACH = 6,                /* foreach */
+    PHPLEXER_SUBTYPE_KEYWORD_BREAK = 7,                  /* break */
+    PHPLEXER_SUBTYPE_KEYWORD_CONTINUE = 8,               /* continue */
+    PHPLEXER_SUBTYPE_KEYWORD_FUNCTION = 9,               /* function */
+    PHPLEXER_SUBTYPE_KEYWORD_RETURN = 10,                /* return */
+    PHPLEXER_SUBTYPE_KEYWORD_ECHO = 11,                  /* echo */
+
+    /* Operators written as keywords */
+    PHPLEXER_SUBTYPE_OPERATOR_AND = 12,                  /* and */
+    PHPLEXER_SUBTYPE_OPERATOR_OR = 13,                   /* or */
+    PHPLEXER_SUBTYPE_OPERATOR_XOR = 14,                  /* xor */
+
+    /* Operators */
+    PHPLEXER_SUBTYPE_OPERATOR_PLUS = 15,                 /* + */
+    PHPLEXER_SUBTYPE_OPERATOR_MINUS = 16,                /* - */
+    PHPLEXER_SUBTYPE_OPERATOR_MULTIPLY = 17,             /* * */
+    PHPLEXER_SUBTYPE_OPERATOR_DIVIDE = 18,               /* / */
+    PHPLEXER_SUBTYPE_OPERATOR_MODULO = 19,               /* % */
+    PHPLEXER_SUBTYPE_OPERATOR_CONCAT = 20,               /* . */
+    PHPLEXER_SUBTYPE_OPERATOR_PLUS_ASSIGN = 21,          /* += */
+    PHPLEXER_SUBTYPE_OPERATOR_MINUS_ASSIGN = 22,         /* -= */
+    PHPLEXER_SUBTYPE_OPERATOR_MULTIPLY_ASSIGN = 23,      /* *= */
+    PHPLEXER_SUBTYPE_OPERATOR_DIVIDE_ASSIGN = 24,        /* /= */
+    PHPLEXER_SUBTYPE_OPERATOR_MODULO_ASSIGN = 25,        /* %= */
+    PHPLEXER_SUBTYPE_OPERATOR_CONCAT_ASSIGN = 26,        /* .= */
+    PHPLEXER_SUBTYPE_OPERATOR_ASSIGN = 27,               /* = */
+    PHPLEXER_SUBTYPE_OPERATOR_EQUAL = 28,                /* == */
+    PHPLEXER_SUBTYPE_OPERATOR_IDENTICAL = 29,            /* === */
+    PHPLEXER_SUBTYPE_OPERATOR_NOT = 30,                  /* ! */
+    PHPLEXER_SUBTYPE_OPERATOR_NOT_EQUAL = 31,            /* != */
+    PHPLEXER_SUBTYPE_OPERATOR_NOT_IDENTICAL = 32,        /* !== */
+    PHPLEXER_SUBTYPE_OPERATOR_LESS = 33,                 /* < */
+    PHPLEXER_SUBTYPE_OPERATOR_LESS_EQUAL = 34,           /* <= */
+    PHPLEXER_SUBTYPE_OPERATOR_SPACESHIP = 35,            /* <=> */
+    PHPLEXER_SUBTYPE_OPERATOR_SHIFT_LEFT = 36,           /* << */
+    PHPLEXER_SUBTYPE_OPERATOR_ARRAY_NOT_EQUAL = 37,      /* <> */
+    PHPLEXER_SUBTYPE_OPERATOR_GREATER = 38,              /* > */
+    PHPLEXER_SUBTYPE_OPERATOR_GREATER_EQUAL = 39,        /* >= */
+    PHPLEXER_SUBTYPE_OPERATOR_SHIFT_RIGHT = 40,          /* >> */
+    PHPLEXER_SUBTYPE_OPERATOR_BITWISE_AND = 41,          /* & */
+    PHPLEXER_SUBTYPE_OPERATOR_LOGICAL_AND = 42,          /* && */
+    PHPLEXER_SUBTYPE_OPERATOR_BITWISE_OR = 43,           /* | */
+    PHPLEXER_SUBTYPE_OPERATOR_LOGICAL_OR = 44,           /* || */
+    PHPLEXER_SUBTYPE_OPERATOR_BITWISE_XOR = 45,          /* ^ */
+    PHPLEXER_SUBTYPE_OPERATOR_BITWISE_NOT = 46,          /* ~ */
+    PHPLEXER_SUBTYPE_OPERATOR_COLON = 47,                /* : */
+    PHPLEXER_SUBTYPE_OPERATOR_ERROR_CONTROL = 48,        /* @ */
+    PHPLEXER_SUBTYPE_OPERATOR_QUESTION = 49,             /* ? */
+    PHPLEXER_SUBTYPE_OPERATOR_NULL_COALESCING = 50,      /* ?? */
+
+    /* Punctuation */
+    PHPLEXER_SUBTYPE_PUNCTUATION_SEMICOLON = 51,         /* ; */
+    PHPLEXER_SUBTYPE_PUNCTUATION_COMMA = 52,             /* , */
+    PHPLEXER_SUBTYPE_PUNCTUATION_DOUBLE_COLON = 53,      /* :: */
+    PHPLEXER_SUBTYPE_PUNCTUATION_DOUBLE_ARROW = 54,      /* => */
+    PHPLEXER_SUBTYPE_PUNCTUATION_ARROW = 55,             /* -> */
+    PHPLEXER_SUBTYPE_PUNCTUATION_NULLSAFE_ARROW = 56,    /* ?-> */
+    PHPLEXER_SUBTYPE_PUNCTUATION_ELLIPSIS = 57,          /* ... */
+    PHPLEXER_SUBTYPE_PUNCTUATION_LEFT_PARENTHESIS = 58,  /* ( */
+    PHPLEXER_SUBTYPE_PUNCTUATION_RIGHT_PARENTHESIS = 59, /* ) */
+    PHPLEXER_SUBTYPE_PUNCTUATION_LEFT_BRACKET = 60,      /* [ */
+    PHPLEXER_SUBTYPE_PUNCTUATION_RIGHT_BRACKET = 61,     /* ] */
+    PHPLEXER_SUBTYPE_PUNCTUATION_LEFT_BRACE = 62,        /* { */
+    PHPLEXER_SUBTYPE_PUNCTUATION_RIGHT_BRACE = 63,       /* } */
+
+    /* Literals */
+    PHPLEXER_SUBTYPE_BOOLEAN_TRUE = 64,                  /* true */
+    PHPLEXER_SUBTYPE_BOOLEAN_FALSE = 65,                 /* false */
+    PHPLEXER_SUBTYPE_NUL = 66                            /* NULL */
+};
+
+/* Statuses of a lexed input */
+enum {
+    PHPLEXER_OK = 0,
+    PHPLEXER_LEXER_ERROR = 1,     /* The code is invalid, see error of the result */
+    PHPLEXER_ARENA_FULL = 2,      /* Tokens of the input don't fit into the rest of the arena */
+    PHPLEXER_INTERNAL_ERROR = 3
+};
+
+/* Source code to lex, owned by the caller */
+typedef struct {
+    const char* data;
+    size_t length;
+} phplexer_input;
+
+/*
+ * Token, its value is input.data[offset .. offset + length).
+ * Keywords, operators, punctuation, booleans and NULL have a subtype (PHPLEXER_SUBTYPE_*,
+ * e.g. PHPLEXER_SUBTYPE_OPERATOR_IDENTICAL tells "===" from "=="), other tokens have PHPLEXER_SUBTYPE_NONE
+ */
+typedef struct {
+    uint32_t type;
+    uint32_t subtype;
+    size_t offset;
+    size_t length;
+} phplexer_token;
+
+/* Caller's memory for tokens, used counts tokens already written (set it to 0 to reuse the arena) */
+typedef struct {
+    phplexer_token* tokens;
+    size_t capacity;
+    size_t used;
+} phplexer_arena;
+
+/* Result of lexing one input: its tokens are arena.tokens[first_token .. first_token + token_count) */
+typedef struct {
+    int32_t status;
+    uint32_t reserved;
+    size_t first_token;
+    size_t token_count;
+    char error[256]; /* Error message if status isn't PHPLEXER_OK */
+} phplexer_result;
+
+/*
+ * Lexes count inputs, writing their tokens into the arena one after another
+ * and the result of inputs[i] into results[i].
+ * Inputs that fail don't leave tokens in the arena, the rest of inputs are still lexed.
+ * Returns the number of inputs lexed successfully.
+ */
+size_t phplexer_lex_batch(const phplexer_input* inputs, size_t count,
+                          phplexer_arena* arena, phplexer_result* results);
+
+/* Name of the token type, e.g. "IDENTIFIER" */
+const char* phplexer_token_type_name(uint32_t type);
+
+/* Spelling of the token subtype, e.g. "===", empty for 0 and unknown subtypes */
+const char* phplexer_token_subtype_spelling(uint32_t subtype);
+
+uint32_t phplexer_abi_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
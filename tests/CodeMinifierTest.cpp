@@ -0,0 +1,109 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "../CodeMinifier.h"
+
+// Regression checks of CodeMinifier, run from the repository root, exit code is 1 if any fails:
+//     $ g++ tests/CodeMinifierTest.cpp PHPLexer.cpp Utf8Validator.cpp AllocationProfiler.cpp -o CodeMinifierTest && ./CodeMinifierTest
+
+int failures = 0;
+
+void check(bool condition, const std::string& name) {
+    if (!condition) {
+        std::cout << "FAILED: " << name << std::endl;
+        failures++;
+    }
+}
+
+std::string readFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+std::string withoutWhitespace(std::string_view text) {
+    std::string result;
+    for (char ch : text) {
+        if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n') {
+            result += ch;
+        }
+    }
+    return result;
+}
+
+// Tokens of the code without comments, as (type, value) pairs
+std::vector<std::pair<TokenType, std::string>> codeTokens(const std::vector<TokenView>& tokens) {
+    std::vector<std::pair<TokenType, std::string>> result;
+    for (const auto& token : tokens) {
+        if (token.type != TokenType::COMMENT) {
+            result.emplace_back(token.type, std::string(token.value));
+        }
+    }
+    return result;
+}
+
+// The minified code is the code apart from the whitespace and comments, and it lexes into the same tokens
+void checkRoundTrip(const std::string& code, const std::string& name) {
+
+    PHPLexer lexer;
+    std::vector<TokenView> tokens;
+    try {
+        lexer.setSourceView(code);
+        lexer.getTokens(tokens);
+    } catch (const LexerException& e) {
+        return; // Nothing is written for code with errors
+    }
+
+    CodeMinifier minifier;
+    minifier.reset(code);
+    lexer.setSourceView(code);
+    lexer.getTokens(minifier);
+    std::string output(minifier.getOutput());
+
+    // The code with comment spans cut out
+    std::string withoutComments;
+    const char* copied = code.data();
+    for (const auto& token : tokens) {
+        if (token.type == TokenType::COMMENT) {
+            withoutComments.append(copied, token.value.data());
+            copied = token.value.data() + token.value.length();
+        }
+    }
+    withoutComments.append(copied, code.data() + code.length());
+    check(withoutWhitespace(output) == withoutWhitespace(withoutComments), "only trivia removed from " + name);
+
+    std::vector<TokenView> outputTokens;
+    try {
+        lexer.setSourceView(output);
+        lexer.getTokens(outputTokens);
+        check(codeTokens(outputTokens) == codeTokens(tokens), "same tokens of " + name);
+    } catch (const LexerException& e) {
+        check(false, "minified " + name + " lexes: " + e.what());
+    }
+}
+
+int main() {
+
+    size_t fileCount = 0;
+    for (const auto& entry : std::filesystem::directory_iterator("examples")) {
+        if (entry.path().extension() == ".php") {
+            checkRoundTrip(readFile(entry.path().string()), entry.path().string());
+            fileCount++;
+        }
+    }
+    check(fileCount > 0, "examples found (run from the repository root)");
+
+    // Bytes not starting any token are kept, only whitespace and comments go
+    checkRoundTrip("if \\\"hello\\\" or $a", "backslashes");
+    checkRoundTrip("$a = 1; ` // comment\n $b", "backtick");
+    checkRoundTrip("\xEF\xBB\xBF$a /* c */ \\ ", "byte order mark and trailing byte");
+
+    if (failures == 0) {
+        std::cout << "All checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include "../ConcurrentLexer.h"
+
+// Regression checks of ConcurrentLexer, exit code is 1 if any fails (or if it hangs for a minute):
+//     $ g++ tests/ConcurrentLexerTest.cpp ConcurrentLexer.cpp PHPLexer.cpp Utf8Validator.cpp AllocationProfiler.cpp -pthread -o ConcurrentLexerTest && ./ConcurrentLexerTest
+
+int failures = 0;
+
+void check(bool condition, const std::string& name) {
+    if (!condition) {
+        std::cout << "FAILED: " << name << std::endl;
+        failures++;
+    }
+}
+
+// Tokens given by the concurrent lexer are the same as of PHPLexer, consumed slowly if isSlow
+void checkSameTokens(const std::string& code, size_t batchSize, size_t ringSize, bool isSlow) {
+
+    PHPLexer lexer;
+    std::vector<TokenView> expected;
+    lexer.setSourceView(code);
+    lexer.getTokens(expected);
+
+    ConcurrentLexer concurrentLexer(batchSize, ringSize);
+    concurrentLexer.start(code);
+    std::vector<TokenView> tokens;
+    const TokenView* batch;
+    size_t count;
+    while (concurrentLexer.nextBatch(batch, count)) {
+        tokens.insert(tokens.end(), batch, batch + count);
+        if (isSlow) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200)); // The lexer sleeps on the full ring
+        }
+    }
+
+    bool isSame = tokens.size() == expected.size();
+    for (size_t i = 0; isSame && i < tokens.size(); i++) {
+        isSame = tokens[i].type == expected[i].type && tokens[i].value == expected[i].value;
+    }
+    check(isSame, "same tokens with batch " + std::to_string(batchSize) + ", ring " + std::to_string(ringSize)
+        + (isSlow ? ", slow consumer" : ""));
+}
+
+int main() {
+
+    // A hang is a failure too
+    std::thread([]() {
+        std::this_thread::sleep_for(std::chrono::minutes(1));
+        std::cout << "FAILED: timed out" << std::endl;
+        std::_Exit(1);
+    }).detach();
+
+    std::string code;
+    for (int i = 0; i < 200; i++) {
+        code += "$a" + std::to_string(i) + " = " + std::to_string(i) + "; // comment\n";
+    }
+
+    for (size_t ringSize : {0, 1, 2, 3}) {
+        for (size_t batchSize : {0, 1, 2, 7}) {
+            checkSameTokens(code, batchSize, ringSize, false);
+        }
+    }
+    checkSameTokens(code, 1, 2, true);
+    checkSameTokens(code, 16, 2, true);
+
+    // Destroying the lexer blocked on the full ring stops it
+    {
+        ConcurrentLexer lexer(1, 2);
+        lexer.start(code);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    if (failures == 0) {
+        std::cout << "All checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
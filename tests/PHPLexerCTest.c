@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <string.h>
+#include "../phplexer.h"
+
+/*
+ * Regression checks of the C interface, built as C and linked with the library, exit code is 1 if any fails:
+ *     $ g++ -c PHPLexer.cpp Utf8Validator.cpp ConcurrentLexer.cpp PHPLexerC.cpp && gcc tests/PHPLexerCTest.c PHPLexer.o Utf8Validator.o ConcurrentLexer.o PHPLexerC.o -lstdc++ -pthread -o PHPLexerCTest && ./PHPLexerCTest
+ */
+
+static int failures = 0;
+
+static void check(int condition, const char* name) {
+    if (!condition) {
+        printf("FAILED: %s\n", name);
+        failures++;
+    }
+}
+
+static phplexer_input input(const char* code) {
+    phplexer_input result;
+    result.data = code;
+    result.length = strlen(code);
+    return result;
+}
+
+static int isToken(const phplexer_input* in, const phplexer_token* token, uint32_t type, uint32_t subtype, const char* value) {
+    return token->type == type && token->subtype == subtype && token->length == strlen(value)
+        && token->offset + token->length <= in->length && memcmp(in->data + token->offset, value, token->length) == 0;
+}
+
+static void testBatch(void) {
+    phplexer_input inputs[3];
+    phplexer_result results[3];
+    phplexer_token tokens[32];
+    phplexer_arena arena;
+    const phplexer_token* first;
+    const phplexer_token* third;
+
+    inputs[0] = input("$a = 1;\necho $a;");
+    inputs[1] = input("$s = \"unterminated");
+    inputs[2] = input("if ($b) {}");
+    arena.tokens = tokens;
+    arena.capacity = 32;
+    arena.used = 0;
+
+    check(phplexer_lex_batch(inputs, 3, &arena, results) == 2, "two inputs lexed");
+
+    first = tokens + results[0].first_token;
+    check(results[0].status == PHPLEXER_OK && results[0].first_token == 0 && results[0].token_count == 8
+        && results[0].error[0] == '\0', "result of the first input");
+    check(isToken(&inputs[0], &first[0], PHPLEXER_TOKEN_IDENTIFIER, PHPLEXER_SUBTYPE_NONE, "$a")
+        && isToken(&inputs[0], &first[1], PHPLEXER_TOKEN_OPERATOR, PHPLEXER_SUBTYPE_OPERATOR_ASSIGN, "=")
+        && isToken(&inputs[0], &first[2], PHPLEXER_TOKEN_INTEGER, PHPLEXER_SUBTYPE_NONE, "1")
+        && isToken(&inputs[0], &first[3], PHPLEXER_TOKEN_PUNCTUATION, PHPLEXER_SUBTYPE_PUNCTUATION_SEMICOLON, ";")
+        && isToken(&inputs[0], &first[4], PHPLEXER_TOKEN_KEYWORD, PHPLEXER_SUBTYPE_KEYWORD_ECHO, "echo")
+        && first[4].offset == 8
+        && isToken(&inputs[0], &first[7], PHPLEXER_TOKEN_END_OF_FILE, PHPLEXER_SUBTYPE_NONE, ""), "tokens of the first input");
+
+    /* The failed input leaves no tokens, the next one follows the first */
+    check(results[1].status == PHPLEXER_LEXER_ERROR && results[1].token_count == 0 && results[1].error[0] != '\0',
+        "lexer error of the second input");
+    third = tokens + results[2].first_token;
+    check(results[2].status == PHPLEXER_OK && results[2].first_token == 8 && results[2].token_count == 7
+        && arena.used == 15, "third input after the first");
+    check(isToken(&inputs[2], &third[0], PHPLEXER_TOKEN_KEYWORD, PHPLEXER_SUBTYPE_KEYWORD_IF, "if")
+        && isToken(&inputs[2], &third[1], PHPLEXER_TOKEN_PUNCTUATION, PHPLEXER_SUBTYPE_PUNCTUATION_LEFT_PARENTHESIS, "(")
+        && isToken(&inputs[2], &third[5], PHPLEXER_TOKEN_PUNCTUATION, PHPLEXER_SUBTYPE_PUNCTUATION_RIGHT_BRACE, "}"),
+        "tokens of the third input");
+
+    /* An input not fitting into the rest of the arena is dropped, the arena is kept as it was */
+    arena.capacity = 20;
+    check(phplexer_lex_batch(inputs, 1, &arena, results) == 0 && results[0].status == PHPLEXER_ARENA_FULL
+        && results[0].token_count == 0 && arena.used == 15, "arena full");
+    arena.used = 0;
+    check(phplexer_lex_batch(inputs, 1, &arena, results) == 1 && arena.used == 8, "arena reused");
+
+    /* Missing data is empty code */
+    inputs[0].data = NULL;
+    inputs[0].length = 10;
+    arena.used = 0;
+    check(phplexer_lex_batch(inputs, 1, &arena, results) == 1 && results[0].token_count == 1
+        && tokens[0].type == PHPLEXER_TOKEN_END_OF_FILE, "null data");
+}
+
+/* Each subtype constant is what the lexer gives for its spelling */
+static void testSubtypes(void) {
+    uint32_t subtype;
+    phplexer_input in;
+    phplexer_result result;
+    phplexer_token tokens[4];
+    phplexer_arena arena;
+    char name[64];
+
+    arena.tokens = tokens;
+    arena.capacity = 4;
+    for (subtype = 1; subtype <= PHPLEXER_SUBTYPE_NUL; subtype++) {
+        in = input(phplexer_token_subtype_spelling(subtype));
+        arena.used = 0;
+        snprintf(name, sizeof(name), "subtype %u (%s)", (unsigned)subtype, in.data);
+        check(in.length > 0 && phplexer_lex_batch(&in, 1, &arena, &result) == 1 && result.token_count == 2
+            && tokens[0].subtype == subtype && tokens[0].offset == 0 && tokens[0].length == in.length, name);
+    }
+
+    check(strcmp(phplexer_token_subtype_spelling(PHPLEXER_SUBTYPE_OPERATOR_IDENTICAL), "===") == 0, "spelling of ===");
+    check(strcmp(phplexer_token_subtype_spelling(PHPLEXER_SUBTYPE_KEYWORD_ECHO), "echo") == 0, "spelling of echo");
+    check(strcmp(phplexer_token_subtype_spelling(PHPLEXER_SUBTYPE_NONE), "") == 0, "spelling of no subtype");
+    check(strcmp(phplexer_token_subtype_spelling(PHPLEXER_SUBTYPE_NUL + 1), "") == 0, "spelling of unknown subtype");
+}
+
+static void testNames(void) {
+    check(phplexer_abi_version() == PHPLEXER_ABI_VERSION && PHPLEXER_ABI_VERSION == 2, "ABI version");
+    check(strcmp(phplexer_token_type_name(PHPLEXER_TOKEN_IDENTIFIER), "IDENTIFIER") == 0, "name of identifier");
+    check(strcmp(phplexer_token_type_name(PHPLEXER_TOKEN_END_OF_FILE), "END_OF_FILE") == 0, "name of end of file");
+    check(strcmp(phplexer_token_type_name(PHPLEXER_TOKEN_END_OF_FILE + 1), "UNKNOWN") == 0, "name of unknown type");
+    check(sizeof(phplexer_token) == 8 + 2 * sizeof(size_t), "token layout");
+}
+
+int main(void) {
+    testBatch();
+    testSubtypes();
+    testNames();
+
+    if (failures == 0) {
+        printf("All checks passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "../PHPLexer.h"
+
+// Regression checks of the lexer, exit code is 1 if any fails:
+//     $ g++ tests/PHPLexerTest.cpp PHPLexer.cpp Utf8Validator.cpp AllocationProfiler.cpp -o PHPLexerTest && ./PHPLexerTest
+
+int failures = 0;
+
+void check(bool condition, const std::string& name) {
+    if (!condition) {
+        std::cout << "FAILED: " << name << std::endl;
+        failures++;
+    }
+}
+
+// Lexes the code into tokens, returns false on a lexer error
+bool lex(const std::string& code, std::vector<TokenView>& tokens) {
+    PHPLexer lexer;
+    try {
+        lexer.setSourceView(code);
+        lexer.getTokens(tokens);
+        return true;
+    } catch (const LexerException& e) {
+        return false;
+    }
+}
+
+bool hasBoolean(const std::vector<TokenView>& tokens) {
+    for (const auto& token : tokens) {
+        if (token.type == TokenType::BOOLEAN) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void testBooleans() {
+    std::vector<TokenView> tokens;
+
+    check(lex("$a = true;", tokens) && tokens[2].type == TokenType::BOOLEAN && tokens[2].value == "true"
+        && tokens[2].subtype == TokenSubtype::BOOLEAN_TRUE, "true before punctuation");
+    check(lex("false", tokens) && tokens[0].type == TokenType::BOOLEAN && tokens[0].subtype == TokenSubtype::BOOLEAN_FALSE,
+        "false at the end of the code");
+
+    // Name characters continue the word, so these are not booleans followed by something else
+    for (const std::string code : {"true_x", "true1", "true\xD0\xB6", "false_", "falsey"}) {
+        tokens.clear();
+        bool isLexed = lex(code, tokens);
+        check(!hasBoolean(tokens) && (!isLexed || tokens[0].value == code), "no boolean in " + code);
+    }
+}
+
+// Brackets paired the slow way: a closing bracket looks for the last opened bracket of its kind in the whole stack
+void expectedBrackets(const std::vector<TokenView>& tokens, std::vector<size_t>& matches, std::vector<size_t>& unbalanced) {
+    const std::string opening = "([{";
+    const std::string closing = ")]}";
+    std::vector<size_t> open;
+    matches.assign(tokens.size(), BracketIndex::NO_MATCH);
+    unbalanced.clear();
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (tokens[i].type != TokenType::PUNCTUATION) {
+            continue;
+        }
+        if (opening.find(tokens[i].value[0]) != std::string::npos) {
+            open.push_back(i);
+            continue;
+        }
+        size_t kind = closing.find(tokens[i].value[0]);
+        if (kind == std::string::npos) {
+            continue;
+        }
+        size_t last = open.size();
+        while (last > 0 && tokens[open[last - 1]].value[0] != opening[kind]) {
+            last--;
+        }
+        if (last == 0) {
+            unbalanced.push_back(i);
+            continue;
+        }
+        unbalanced.insert(unbalanced.end(), open.begin() + last, open.end());
+        matches[open[last - 1]] = i;
+        matches[i] = open[last - 1];
+        open.resize(last - 1);
+    }
+    unbalanced.insert(unbalanced.end(), open.begin(), open.end());
+    std::sort(unbalanced.begin(), unbalanced.end());
+}
+
+bool lexBrackets(const std::string& code, std::vector<TokenView>& tokens, BracketIndex& brackets) {
+    PHPLexer lexer;
+    lexer.setSourceView(code);
+    lexer.getTokens(tokens, brackets);
+    return brackets.matches.size() == tokens.size();
+}
+
+void testBrackets() {
+    std::vector<TokenView> tokens;
+    BracketIndex brackets;
+
+    check(lexBrackets("if ($a[1]) { echo ($b); }", tokens, brackets) && brackets.unbalanced.empty()
+        && brackets.matches[1] == 6 && brackets.matches[6] == 1 && brackets.matches[3] == 5 && brackets.matches[5] == 3
+        && brackets.matches[7] == 13 && brackets.matches[13] == 7 && brackets.matches[9] == 11
+        && brackets.matches[0] == BracketIndex::NO_MATCH && brackets.matches[14] == BracketIndex::NO_MATCH, "nested brackets");
+
+    // The closing bracket closes its kind, the bracket opened in between is left unbalanced
+    check(lexBrackets("( [ )", tokens, brackets) && brackets.matches[0] == 2 && brackets.matches[2] == 0
+        && brackets.matches[1] == BracketIndex::NO_MATCH && brackets.unbalanced == std::vector<size_t>{1}, "unclosed inner bracket");
+    check(lexBrackets(") $a ]", tokens, brackets) && brackets.unbalanced == std::vector<size_t>{0, 2}, "nothing to close");
+    check(lexBrackets("{ ( $a } )", tokens, brackets) && brackets.matches[0] == 3
+        && brackets.unbalanced == std::vector<size_t>{1, 4}, "closed after its outer bracket");
+    check(lexBrackets("[ { (", tokens, brackets) && brackets.unbalanced == std::vector<size_t>{0, 1, 2}, "left open");
+
+    // Brackets in strings and comments aren't tokens, the index is cleared by the next lexing
+    check(lexBrackets("'(' /* [ */ $a // {\n", tokens, brackets) && brackets.unbalanced.empty()
+        && brackets.matches == std::vector<size_t>(tokens.size(), BracketIndex::NO_MATCH), "brackets in strings and comments");
+
+    // Random bracket sequences against the slow pairing
+    std::mt19937 random(34);
+    const char parts[] = {'(', ')', '[', ']', '{', '}', 'a'};
+    for (int round = 0; round < 1000; round++) {
+        std::string code;
+        size_t length = random() % 40;
+        for (size_t i = 0; i < length; i++) {
+            char part = parts[random() % sizeof(parts)];
+            code += part == 'a' ? "$a " : std::string(1, part) + " ";
+        }
+        std::vector<size_t> matches;
+        std::vector<size_t> unbalanced;
+        bool isLexed = lexBrackets(code, tokens, brackets);
+        expectedBrackets(tokens, matches, unbalanced);
+        if (!isLexed || brackets.matches != matches || brackets.unbalanced != unbalanced) {
+            check(false, "brackets of " + code);
+            break;
+        }
+    }
+}
+
+int main() {
+    testBooleans();
+    testBrackets();
+
+    if (failures == 0) {
+        std::cout << "All checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
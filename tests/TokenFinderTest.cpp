@@ -0,0 +1,189 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <filesystem>
+#include "../TokenFinder.h"
+
+// Regression checks of TokenFinder (the --find mode), run from the repository root, exit code is 1 if any fails:
+//     $ g++ tests/TokenFinderTest.cpp PHPLexer.cpp Utf8Validator.cpp AllocationProfiler.cpp -o TokenFinderTest && ./TokenFinderTest
+
+int failures = 0;
+
+void check(bool condition, const std::string& name) {
+    if (!condition) {
+        std::cout << "FAILED: " << name << std::endl;
+        failures++;
+    }
+}
+
+std::string readFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// Collects tokens up to a lexer error
+class TokenCollector: public TokenSink {
+public:
+    std::vector<TokenView> tokens;
+
+    void onToken(const TokenView& token) override {
+        tokens.push_back(token);
+    }
+};
+
+// Tokens of the full lexing, returns false if lexing stopped at an error
+bool lexAll(const std::string& code, std::vector<TokenView>& tokens) {
+    PHPLexer lexer;
+    TokenCollector collector;
+    bool isLexed = true;
+    try {
+        lexer.setSourceView(code);
+        lexer.getTokens(collector);
+    } catch (const LexerException& e) {
+        isLexed = false;
+    }
+    tokens = std::move(collector.tokens);
+    return isLexed;
+}
+
+bool isSameHit(const TokenHit& hit, const TokenHit& expected) {
+    return hit.line == expected.line && hit.offset == expected.offset && hit.value == expected.value;
+}
+
+// Hits of the full lexing, in the order of the code
+std::vector<TokenHit> expectedHits(const std::string& code, const std::vector<TokenView>& tokens,
+    const std::vector<TokenPredicate>& predicates) {
+
+    std::vector<TokenHit> hits;
+    size_t line = 1;
+    const char* counted = code.data();
+    for (const auto& token : tokens) {
+        for (const auto& predicate : predicates) {
+            if (predicate.matches(token)) {
+                line += std::count(counted, token.value.data(), '\n');
+                counted = token.value.data();
+                hits.push_back(TokenHit{line, static_cast<size_t>(token.value.data() - code.data()), token.value});
+                break;
+            }
+        }
+    }
+    return hits;
+}
+
+// The finder gives the hits of the full lexing. Where the lexing stops at an error,
+// its hits are the first ones of the finder, which goes on after the error
+void checkHits(const std::string& code, const std::vector<TokenPredicate>& predicates, const std::string& name) {
+
+    std::vector<TokenView> tokens;
+    bool isLexed = lexAll(code, tokens);
+    std::vector<TokenHit> expected = expectedHits(code, tokens, predicates);
+
+    std::vector<TokenHit> hits;
+    TokenFinder finder(predicates);
+    finder.find(code, hits);
+
+    bool isSame = isLexed ? hits.size() == expected.size() : hits.size() >= expected.size();
+    for (size_t i = 0; isSame && i < expected.size(); i++) {
+        isSame = isSameHit(hits[i], expected[i]);
+    }
+    check(isSame, name);
+}
+
+TokenPredicate predicate(const std::string& text) {
+    TokenPredicate result;
+    check(parseTokenPredicate(text, result), "parsed " + text);
+    return result;
+}
+
+// Every value of the code's tokens is looked for on its own (unless the code is large), then all of them at once
+void checkAllValues(const std::string& code, const std::string& name, bool isEachValueChecked) {
+
+    std::vector<TokenView> tokens;
+    lexAll(code, tokens);
+    std::set<std::pair<TokenType, std::string>> values;
+    for (const auto& token : tokens) {
+        if (token.type != TokenType::END_OF_FILE && token.type != TokenType::COMMENT && !token.value.empty()) {
+            values.emplace(token.type, std::string(token.value));
+        }
+    }
+
+    std::vector<TokenPredicate> all;
+    for (const auto& value : values) {
+        all.push_back(TokenPredicate{value.first, value.second, false});
+        if (isEachValueChecked) {
+            checkHits(code, {all.back()}, "hits of " + std::string(tokenTypeName(value.first)) + ":" + value.second + " in " + name);
+        }
+    }
+    checkHits(code, all, "hits of all values in " + name);
+    checkHits(code, {predicate("identifier:$*")}, "hits of identifier prefix in " + name);
+}
+
+void testParse() {
+    TokenPredicate parsed;
+    check(parseTokenPredicate("keyword:echo", parsed) && parsed.type == TokenType::KEYWORD && parsed.value == "echo"
+        && !parsed.isPrefix, "type in lower case");
+    check(parseTokenPredicate("IDENTIFIER:$_GET*", parsed) && parsed.type == TokenType::IDENTIFIER && parsed.value == "$_GET"
+        && parsed.isPrefix, "prefix");
+    check(parseTokenPredicate("operator:*", parsed) && parsed.value == "*" && !parsed.isPrefix, "lone star is a value");
+    check(!parseTokenPredicate("keyword", parsed), "no colon");
+    check(!parseTokenPredicate("keyword:", parsed), "no value");
+    check(!parseTokenPredicate("word:echo", parsed), "unknown type");
+}
+
+void testContexts() {
+    // Occurrences inside strings and comments aren't tokens
+    std::string code = "echo 'echo'; // echo\n/* echo\n echo */ $s = \"a echo\"; # echo\necho $s;";
+    std::vector<TokenHit> hits;
+    std::vector<TokenPredicate> predicates = {predicate("keyword:echo")};
+    TokenFinder finder(predicates);
+    finder.find(code, hits);
+    check(hits.size() == 2 && hits[0].line == 1 && hits[0].offset == 0 && hits[1].line == 4
+        && hits[1].offset == code.rfind("echo"), "occurrences in strings and comments skipped");
+    checkHits(code, predicates, "hits of code with strings and comments");
+
+    // Parts of longer tokens aren't tokens
+    checkHits("$echo = $a; $abc = 1; echoes;", {predicate("keyword:echo"), predicate("identifier:$a")}, "parts of tokens");
+    checkHits("$a = 1; $b = \"unterminated", {predicate("identifier:$a")}, "hits before a lexer error");
+    checkHits("", {predicate("keyword:echo")}, "empty code");
+}
+
+int main() {
+
+    testParse();
+    testContexts();
+
+    size_t fileCount = 0;
+    for (const auto& entry : std::filesystem::directory_iterator("examples")) {
+        if (entry.path().extension() == ".php") {
+            std::string code = readFile(entry.path().string());
+            checkAllValues(code, entry.path().string(), true);
+            fileCount++;
+        }
+    }
+    check(fileCount > 0, "examples found (run from the repository root)");
+
+    // Code spanning several blocks, so occurrences cross their boundaries
+    std::vector<TokenView> tokens;
+    std::string lexable;
+    for (const auto& entry : std::filesystem::directory_iterator("examples")) {
+        std::string code = readFile(entry.path().string());
+        if (entry.path().extension() == ".php" && lexAll(code, tokens)) {
+            lexable += code + "\n";
+        }
+    }
+    std::string large;
+    while (large.length() < 200 * 1024) {
+        large += lexable;
+    }
+    checkAllValues(large, "several blocks", false);
+
+    if (failures == 0) {
+        std::cout << "All checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
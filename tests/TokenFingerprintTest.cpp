@@ -0,0 +1,170 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "../TokenFingerprint.h"
+
+// Regression checks of TokenFingerprinter, exit code is 1 if any fails:
+//     $ g++ tests/TokenFingerprintTest.cpp PHPLexer.cpp Utf8Validator.cpp AllocationProfiler.cpp -o TokenFingerprintTest && ./TokenFingerprintTest
+
+int failures = 0;
+
+void check(bool condition, const std::string& name) {
+    if (!condition) {
+        std::cout << "FAILED: " << name << std::endl;
+        failures++;
+    }
+}
+
+const std::string CODE =
+    "$total = 0;\n"
+    "while ($i < 10) { // Summing up\n"
+    "    if ($i > 5) { $total += $i * 2; } else { $total -= 1; }\n"
+    "    $i = $i + 1;\n"
+    "}\n"
+    "echo $total;\n";
+
+std::vector<TokenView> lex(const std::string& code) {
+    PHPLexer lexer;
+    std::vector<TokenView> tokens;
+    lexer.setSourceView(code);
+    lexer.getTokens(tokens);
+    return tokens;
+}
+
+std::vector<Fingerprint> fingerprint(const std::string& code, size_t k, size_t w) {
+    PHPLexer lexer;
+    TokenFingerprinter fingerprinter(k, w);
+    fingerprinter.reset(code);
+    lexer.setSourceView(code);
+    lexer.getTokens(fingerprinter);
+    return fingerprinter.getFingerprints();
+}
+
+// Fingerprints computed the slow way: every k-gram hashed on its own,
+// the rightmost minimum of every window selected, each selected k-gram recorded once
+std::vector<Fingerprint> expectedFingerprints(const std::string& code, size_t k, size_t w) {
+
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+    std::vector<uint64_t> hashes;
+    std::vector<size_t> offsets;
+    for (const auto& token : lex(code)) {
+        if (token.type == TokenType::COMMENT || token.type == TokenType::END_OF_FILE) {
+            continue;
+        }
+        uint64_t hash = (14695981039346656037ULL ^ static_cast<uint64_t>(token.type)) * FNV_PRIME;
+        bool isPlaceholder = token.type == TokenType::IDENTIFIER || token.type == TokenType::INTEGER
+            || token.type == TokenType::FLOAT || token.type == TokenType::STRING
+            || token.type == TokenType::BOOLEAN || token.type == TokenType::NUL;
+        if (!isPlaceholder) {
+            for (char ch : token.value) {
+                hash = (hash ^ static_cast<unsigned char>(ch)) * FNV_PRIME;
+            }
+        }
+        hashes.push_back(hash);
+        offsets.push_back(token.value.data() - code.data());
+    }
+
+    std::vector<Fingerprint> kgrams;
+    for (size_t i = 0; i + k <= hashes.size(); i++) {
+        uint64_t hash = 0;
+        for (size_t j = i; j < i + k; j++) {
+            hash = hash * FNV_PRIME + hashes[j]; // The rolling hash uses the FNV prime as the base
+        }
+        kgrams.push_back(Fingerprint{hash, offsets[i]});
+    }
+
+    std::vector<Fingerprint> result;
+    size_t windowCount = kgrams.size() >= w ? kgrams.size() - w + 1 : (kgrams.empty() ? 0 : 1);
+    size_t lastSelected = SIZE_MAX;
+    for (size_t start = 0; start < windowCount; start++) {
+        size_t selected = start;
+        for (size_t i = start; i < std::min(start + w, kgrams.size()); i++) {
+            if (kgrams[i].hash <= kgrams[selected].hash) {
+                selected = i;
+            }
+        }
+        if (selected != lastSelected) {
+            result.push_back(kgrams[selected]);
+            lastSelected = selected;
+        }
+    }
+    return result;
+}
+
+bool isSame(const std::vector<Fingerprint>& a, const std::vector<Fingerprint>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].hash != b[i].hash || a[i].offset != b[i].offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testWinnowing() {
+    for (size_t k : {1, 2, 5}) {
+        for (size_t w : {1, 3, 4, 100}) {
+            std::vector<Fingerprint> fingerprints = fingerprint(CODE, k, w);
+            check(!fingerprints.empty(), "fingerprints of the code with k " + std::to_string(k) + " w " + std::to_string(w));
+            check(isSame(fingerprints, expectedFingerprints(CODE, k, w)),
+                "expected fingerprints with k " + std::to_string(k) + " w " + std::to_string(w));
+        }
+    }
+}
+
+void testNormalisation() {
+    // Renamed identifiers, changed literals, comments and whitespace give the same hashes
+    std::string renamed = "$sum=1;while($n<3){if($n>7){$sum+=$n*4;}else{$sum-=9;}$n=$n+2;} echo $sum; /* done */";
+    std::vector<Fingerprint> original = fingerprint(CODE, 5, 4);
+    std::vector<Fingerprint> copy = fingerprint(renamed, 5, 4);
+    bool isSameHashes = original.size() == copy.size();
+    for (size_t i = 0; isSameHashes && i < original.size(); i++) {
+        isSameHashes = original[i].hash == copy[i].hash;
+    }
+    check(isSameHashes, "renamed copy has the same hashes");
+
+    // A changed operator changes them
+    std::string changed = CODE;
+    changed.replace(changed.find("* 2"), 1, "/");
+    std::vector<Fingerprint> other = fingerprint(changed, 5, 4);
+    check(!isSame(original, other), "changed operator changes the fingerprints");
+}
+
+void testKnownHashes() {
+    // Hashes are compared across runs and files, so they must not change
+    std::vector<Fingerprint> fingerprints = fingerprint("$a = 1;\necho $a;", 2, 2);
+    check(isSame(fingerprints, {{1184293936082968574ULL, 0}, {1172782049337870104ULL, 5}, {532220715374998153ULL, 8}}),
+        "known hashes");
+}
+
+void testZeroLengths() {
+    // 0 is taken as 1 instead of dividing by zero
+    check(isSame(fingerprint(CODE, 0, 4), fingerprint(CODE, 1, 4)), "k 0 is k 1");
+    check(isSame(fingerprint(CODE, 5, 0), fingerprint(CODE, 5, 1)), "w 0 is w 1");
+    check(isSame(fingerprint(CODE, 0, 0), expectedFingerprints(CODE, 1, 1)), "k and w 0");
+}
+
+void testShortCode() {
+    check(fingerprint("", 5, 4).empty(), "no fingerprints of empty code");
+    check(fingerprint("$a;", 5, 4).empty(), "no fingerprints of code shorter than a k-gram");
+    // Fewer k-grams than a window still give one fingerprint
+    check(isSame(fingerprint("$a = 1;", 2, 4), expectedFingerprints("$a = 1;", 2, 4))
+        && fingerprint("$a = 1;", 2, 4).size() == 1, "one fingerprint of code shorter than a window");
+}
+
+int main() {
+    testWinnowing();
+    testNormalisation();
+    testKnownHashes();
+    testZeroLengths();
+    testShortCode();
+
+    if (failures == 0) {
+        std::cout << "All checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
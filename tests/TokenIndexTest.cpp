@@ -0,0 +1,181 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <filesystem>
+#include <unistd.h>
+#include "../TokenIndex.h"
+
+// Regression checks of TokenIndexBuilder and MappedTokenIndex (the --index and --lookup modes),
+// run from the repository root, exit code is 1 if any fails:
+//     $ g++ tests/TokenIndexTest.cpp PHPLexer.cpp Utf8Validator.cpp AllocationProfiler.cpp -pthread -o TokenIndexTest && ./TokenIndexTest
+
+int failures = 0;
+
+void check(bool condition, const std::string& name) {
+    if (!condition) {
+        std::cout << "FAILED: " << name << std::endl;
+        failures++;
+    }
+}
+
+std::string readFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+void writeFile(const std::string& filename, const std::string& content) {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file << content;
+}
+
+// (path, offset, line) of a token
+using Place = std::tuple<std::string, uint64_t, uint64_t>;
+
+// Collects identifiers and keywords up to a lexer error, as the index does
+class PlaceSink: public TokenSink {
+public:
+    std::map<std::string, std::vector<Place>>* places;
+    std::string path;
+    const char* sourceStart;
+
+    void onToken(const TokenView& token) override {
+        if (token.type == TokenType::IDENTIFIER || token.type == TokenType::KEYWORD) {
+            uint64_t offset = token.value.data() - sourceStart;
+            uint64_t line = 1 + std::count(sourceStart, token.value.data(), '\n');
+            (*places)[std::string(token.value)].emplace_back(path, offset, line);
+        }
+    }
+};
+
+// Places of every value found by lexing all files of the directory
+std::map<std::string, std::vector<Place>> lexPlaces(const std::string& directory) {
+    std::map<std::string, std::vector<Place>> places;
+    PHPLexer lexer;
+    for (const auto& path : collectPhpFiles(directory)) {
+        std::string code = readFile(path);
+        PlaceSink sink;
+        sink.places = &places;
+        sink.path = path;
+        sink.sourceStart = code.data();
+        try {
+            lexer.setSourceView(code);
+            lexer.getTokens(sink);
+        } catch (const LexerException& e) {
+        }
+    }
+    return places;
+}
+
+// Places of every value read from the index
+std::map<std::string, std::vector<Place>> indexPlaces(const MappedTokenIndex& index) {
+    std::map<std::string, std::vector<Place>> places;
+    for (size_t term = 0; term < index.getTermCount(); term++) {
+        std::vector<Place>& termPlaces = places[std::string(index.getTermValue(term))];
+        bool isValid = index.forEachPosting(term, [&](uint32_t file, uint64_t offset, uint64_t line) {
+            termPlaces.emplace_back(std::string(index.getPath(file)), offset, line);
+        });
+        check(isValid, "postings of " + std::string(index.getTermValue(term)));
+    }
+    return places;
+}
+
+void checkIndex(const std::string& directory, const std::string& indexPath, const std::string& name) {
+
+    MappedTokenIndex index;
+    if (!index.open(indexPath)) {
+        check(false, "index opened " + name);
+        return;
+    }
+    std::vector<std::string> paths = collectPhpFiles(directory);
+    bool isSamePaths = index.getFileCount() == paths.size();
+    for (size_t i = 0; isSamePaths && i < paths.size(); i++) {
+        isSamePaths = index.getPath(i) == paths[i];
+    }
+    check(isSamePaths, "files of the index " + name);
+    check(indexPlaces(index) == lexPlaces(directory), "postings are the places of lexed tokens " + name);
+
+    // Terms are sorted for lookups
+    bool isSorted = true;
+    for (size_t term = 1; term < index.getTermCount(); term++) {
+        isSorted = isSorted && index.getTermValue(term - 1) < index.getTermValue(term);
+    }
+    check(isSorted, "sorted terms " + name);
+    size_t term = index.lowerBound("$a");
+    check(term < index.getTermCount() && index.getTermValue(term) == "$a", "lookup of a value " + name);
+    term = index.lowerBound("$");
+    check(term < index.getTermCount() && index.getTermValue(term)[0] == '$' && (term == 0 || index.getTermValue(term - 1) < "$"),
+        "lookup of a prefix " + name);
+    check(index.lowerBound("\x7F") == index.getTermCount(), "lookup past the last value " + name);
+}
+
+int main() {
+
+    std::string directory = (std::filesystem::temp_directory_path() / ("TokenIndexTest." + std::to_string(getpid()))).string();
+    std::string indexPath = directory + ".idx";
+    std::string scratchPath = directory + ".scratch.idx";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory + "/sub");
+
+    size_t fileCount = 0;
+    for (const auto& entry : std::filesystem::directory_iterator("examples")) {
+        if (entry.path().extension() == ".php") {
+            std::filesystem::copy_file(entry.path(), directory + "/" + entry.path().filename().string());
+            fileCount++;
+        }
+    }
+    check(fileCount > 0, "examples found (run from the repository root)");
+    writeFile(directory + "/sub/a.php", "$a = 1;\nforeach ($list) { echo $item; }");
+    writeFile(directory + "/sub/b.php", "$b = 2;\n\nwhile ($b) { $b = $b - 1; }");
+    writeFile(directory + "/sub/broken.php", "$before = 1; $s = \"unterminated");
+
+    // The first build lexes everything
+    TokenIndexBuilder builder;
+    TokenIndexBuilder::Stats stats;
+    check(builder.build(directory, indexPath, stats) && stats.isWritten, "index built");
+    check(stats.files == fileCount + 3 && stats.lexedFiles == stats.files && stats.unchangedFiles == 0, "all files lexed");
+    check(stats.errorFiles >= 1, "lexer error counted");
+    checkIndex(directory, indexPath, "built from scratch");
+
+    // Nothing changed, nothing is lexed or written
+    std::string built = readFile(indexPath);
+    check(builder.build(directory, indexPath, stats) && !stats.isWritten && stats.lexedFiles == 0, "unchanged tree not indexed again");
+    check(readFile(indexPath) == built, "unchanged index");
+
+    // Changed, added and removed files: only the changed and added ones are lexed
+    writeFile(directory + "/sub/a.php", "$a = 1;\n\nreturn $a + $other;");
+    writeFile(directory + "/sub/c.php", "if ($c) { break; }");
+    std::filesystem::remove(directory + "/sub/b.php");
+    check(builder.build(directory, indexPath, stats) && stats.isWritten, "index rebuilt");
+    check(stats.lexedFiles == 2 && stats.unchangedFiles == fileCount + 1, "only changed files lexed");
+    checkIndex(directory, indexPath, "rebuilt");
+
+    // The incremental rebuild gives the same bytes as a build from scratch
+    check(builder.build(directory, scratchPath, stats) && stats.lexedFiles == stats.files, "index built again from scratch");
+    check(readFile(indexPath) == readFile(scratchPath), "rebuilt index same as built from scratch");
+
+    // A damaged index isn't opened, and is replaced by a build from scratch
+    std::string damaged = readFile(indexPath);
+    writeFile(indexPath, damaged.substr(0, damaged.length() - 1));
+    MappedTokenIndex index;
+    check(!index.open(indexPath), "truncated index rejected");
+    damaged[0] = 'X';
+    writeFile(indexPath, damaged);
+    check(!index.open(indexPath), "index with a wrong magic rejected");
+    check(builder.build(directory, indexPath, stats) && stats.lexedFiles == stats.files, "damaged index built from scratch");
+    check(readFile(indexPath) == readFile(scratchPath), "damaged index replaced");
+
+    std::filesystem::remove_all(directory);
+    std::filesystem::remove(indexPath);
+    std::filesystem::remove(scratchPath);
+
+    if (failures == 0) {
+        std::cout << "All checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
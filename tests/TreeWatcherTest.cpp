@@ -0,0 +1,134 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <unistd.h>
+#include "../TreeWatcher.h"
+
+// Regression checks of TreeWatcher (the --watch mode), exit code is 1 if any fails:
+//     $ g++ tests/TreeWatcherTest.cpp PHPLexer.cpp Utf8Validator.cpp AllocationProfiler.cpp -pthread -o TreeWatcherTest && ./TreeWatcherTest
+
+int failures = 0;
+
+void check(bool condition, const std::string& name) {
+    if (!condition) {
+        std::cout << "FAILED: " << name << std::endl;
+        failures++;
+    }
+}
+
+void writeFile(const std::string& filename, const std::string& content) {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    file << content;
+}
+
+bool contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+// Updates come after the debounce delay, so the reply is asked for until it's as expected or the time is over
+bool waitFor(const TreeWatcher& watcher, const std::string& query, const std::function<bool(const std::string&)>& isExpected) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!isExpected(watcher.query(query))) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            std::cout << "Last reply to " << query << ": " << watcher.query(query) << std::endl;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+int main() {
+
+    std::string root = (std::filesystem::temp_directory_path() / ("TreeWatcherTest." + std::to_string(getpid()))).string();
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root + "/lib");
+    writeFile(root + "/a.php", "$a = 1;\necho $a;");
+    writeFile(root + "/lib/b.php", "if ($b) { return 2; }");
+    writeFile(root + "/notes.txt", "$ignored = 1;");
+
+    TreeWatcher watcher(root);
+    if (!watcher.start()) {
+        std::cout << "inotify is not available" << std::endl;
+        std::filesystem::remove_all(root);
+        return 1;
+    }
+
+    // The tree is lexed by start()
+    check(watcher.query("files") == "{\"files\":[{\"path\":\"" + root + "/a.php\",\"tokens\":8},{\"path\":\""
+        + root + "/lib/b.php\",\"tokens\":10}]}", "files of the tree");
+    check(watcher.query("tokens " + root + "/a.php") == "{\"tokens\":[{\"type\":\"IDENTIFIER\",\"value\":\"$a\",\"line\":1},"
+        "{\"type\":\"OPERATOR\",\"value\":\"=\",\"line\":1},{\"type\":\"INTEGER\",\"value\":\"1\",\"line\":1},"
+        "{\"type\":\"PUNCTUATION\",\"value\":\";\",\"line\":1},{\"type\":\"KEYWORD\",\"value\":\"echo\",\"line\":2},"
+        "{\"type\":\"IDENTIFIER\",\"value\":\"$a\",\"line\":2},{\"type\":\"PUNCTUATION\",\"value\":\";\",\"line\":2},"
+        "{\"type\":\"END_OF_FILE\",\"value\":\"\",\"line\":2}]}", "tokens of a file");
+    check(watcher.query("tokens " + root + "/lib/../a.php") == watcher.query("tokens " + root + "/a.php"), "path normalised");
+    check(contains(watcher.query("tokens " + root + "/notes.txt"), "\"error\":\"Not indexed: "), "other files not indexed");
+    check(watcher.query("find KEYWORD:return") == "{\"hits\":[{\"path\":\"" + root + "/lib/b.php\",\"line\":1,\"value\":\"return\"}]}",
+        "hits of the tree");
+    check(contains(watcher.query("stats"), "{\"files\":2,\"tokens\":18,"), "stats of the tree");
+    check(contains(watcher.query("find NOTYPE:x"), "\"error\":\"Wrong predicate: NOTYPE:x\""), "wrong predicate");
+    check(contains(watcher.query("unknown"), "\"error\":\"Unknown query: unknown\""), "unknown query");
+
+    // A written file is lexed again
+    writeFile(root + "/a.php", "$a = 1;\n\nreturn $a;");
+    check(waitFor(watcher, "find KEYWORD:return", [&](const std::string& reply) {
+        return contains(reply, "{\"path\":\"" + root + "/a.php\",\"line\":3,\"value\":\"return\"}");
+    }), "written file updated");
+    check(!contains(watcher.query("find KEYWORD:echo"), "a.php"), "old tokens of the written file gone");
+
+    // A created file is added, with its lexer error
+    writeFile(root + "/lib/broken.php", "$s = \"unterminated");
+    check(waitFor(watcher, "files", [&](const std::string& reply) {
+        return contains(reply, "{\"path\":\"" + root + "/lib/broken.php\",\"error\":\"");
+    }), "created file with an error added");
+    check(waitFor(watcher, "stats", [](const std::string& reply) {
+        return contains(reply, "{\"files\":3,") && contains(reply, "\"errors\":1,");
+    }), "stats count the error");
+
+    // A file moved in from outside the tree is added, a deleted one is removed
+    std::string outside = root + ".outside.php";
+    writeFile(outside, "echo 3;");
+    std::filesystem::rename(outside, root + "/lib/moved.php");
+    std::filesystem::remove(root + "/lib/broken.php");
+    check(waitFor(watcher, "files", [&](const std::string& reply) {
+        return contains(reply, root + "/lib/moved.php") && !contains(reply, "broken.php");
+    }), "moved file added and deleted file removed");
+
+    // A directory created with files in it is lexed as a whole
+    std::string staging = root + ".staging";
+    std::filesystem::create_directories(staging + "/deep");
+    writeFile(staging + "/deep/c.php", "while ($c) { break; }");
+    std::filesystem::rename(staging, root + "/new");
+    check(waitFor(watcher, "find KEYWORD:break", [&](const std::string& reply) {
+        return contains(reply, root + "/new/deep/c.php");
+    }), "files of a moved in directory added");
+
+    // Files in a directory created later are watched too
+    writeFile(root + "/new/deep/d.php", "continue;");
+    check(waitFor(watcher, "find KEYWORD:continue", [&](const std::string& reply) {
+        return contains(reply, root + "/new/deep/d.php");
+    }), "new file in a new directory added");
+
+    // A directory moved out of the tree takes its files with it
+    std::filesystem::rename(root + "/lib", staging);
+    check(waitFor(watcher, "files", [&](const std::string& reply) {
+        return !contains(reply, "/lib/");
+    }), "files of a moved out directory removed");
+    check(waitFor(watcher, "stats", [](const std::string& reply) {
+        return contains(reply, "{\"files\":3,") && contains(reply, "\"errors\":0,");
+    }), "stats after the changes");
+
+    watcher.stop();
+    std::filesystem::remove_all(root);
+    std::filesystem::remove_all(staging);
+
+    if (failures == 0) {
+        std::cout << "All checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}